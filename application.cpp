@@ -9,8 +9,9 @@ namespace Scaffold
 {
     //=========================================================================
 
-    DispatchThread::DispatchThread() : 
-        scheduler_ (0), stop_ (false) 
+    DispatchThread::DispatchThread (int worker) : 
+        scheduler_ (0), worker_ (worker), delta_ (0), 
+        budget_ (0), spent_ (0), last_frame_ (0), stop_ (false) 
     {}
 
     void DispatchThread::setScheduler (Framework::Scheduler *s) 
@@ -21,53 +22,108 @@ namespace Scaffold
     void DispatchThread::setFrameDelta (frame_delta_t d) 
     { 
         delta_ = d; 
+
+        // called once per frame; starts a fresh budget
+        Locker mtx (frame_lock_);
+        frame_.ref ();
+        frame_tick_.wakeAll ();
+    }
+
+    void DispatchThread::setFrameBudget (frame_delta_t b) 
+    { 
+        budget_ = b; 
     }
 
     void DispatchThread::run ()
     {
-        int num;
-
         while (!stop_) 
         {
-            num = scheduler_->length ();
-            while (num --) scheduler_->dispatch (delta_);
+            if (budget_ > 0)
+                dispatch_budgeted_ ();
+            else
+                while (!stop_ && scheduler_->dispatch (worker_, delta_));
 
-            QThread::yieldCurrentThread ();
+            // sleep until work is enqueued instead of spinning
+            if (!stop_) scheduler_->wait (worker_);
         }
     }
 
     void DispatchThread::stop ()
     {
         stop_ = true;
+
+        if (scheduler_) scheduler_->wake ();
+
+        Locker mtx (frame_lock_);
+        frame_tick_.wakeAll ();
+    }
+
+    void DispatchThread::dispatch_budgeted_ ()
+    {
+        int frame = frame_;
+
+        if (frame != last_frame_)
+        {
+            spent_ = 0;
+            last_frame_ = frame;
+        }
+
+        Framework::Scheduler::Slice slice = 
+            scheduler_->dispatch (worker_, delta_, budget_ - spent_);
+
+        spent_ += slice.elapsed;
+
+        // budget used up; leftovers are carried over to the next frame
+        if (spent_ >= budget_)
+            wait_frame_ (frame);
+    }
+
+    void DispatchThread::wait_frame_ (int frame)
+    {
+        Locker mtx (frame_lock_);
+
+        if (!stop_ && frame_ == frame)
+            frame_tick_.wait (&frame_lock_, Framework::SCHEDULER_IDLE_WAIT);
     }
     
     //=========================================================================
 
-    Application::Application (int &argc, char **argv) :
-        QApplication (argc, argv), app_ (0), world_ (0)
+    Application::Application (int &argc, char **argv, int workers, bool gui) :
+        QApplication (argc, argv, gui), app_ (0), world_ (0), scheduler_ (workers),
+        tracing_ (false), parallel_pump_ (false), profiler_ (0), profiled_ (0), 
+        step_ (0), last_frame_ (0), next_tick_ (0), remainder_ (0)
     {
         // set up components for application entity
         do_entity_initialize ();
 
-        // set thread's scheduler
-        thread_.setScheduler (&scheduler_);
+        // set up one dispatch thread per scheduler worker
+        for (int i = 0; i < scheduler_.workers (); ++i)
+        {
+            threads_.push_back (new DispatchThread (i));
+            threads_.back()->setScheduler (&scheduler_);
+        }
 
         // set up main loop real-time timer
         connect (&frame_timer_, SIGNAL (timeout()), this, SLOT (update()));
         frame_timer_.setSingleShot (true);
         frame_timer_.start (0);
-        time_.start ();
+        setFrameRate (APPLICATION_FRAME_RATE);
 
         // set thread's real-time delta values
         app_->state = Framework::AppState::READY;
-        app_->delta.on_value_change += bind
-            (&DispatchThread::setFrameDelta, &thread_, _1);
+        DispatchThread::List::iterator i = threads_.begin();
+        DispatchThread::List::iterator e = threads_.end();
+        for (; i != e; ++i) 
+            app_->delta.on_value_change += bind
+                (&DispatchThread::setFrameDelta, *i, _1);
     }
 
     Application::~Application ()
     {
-        thread_.stop ();
-        thread_.wait (1000);
+        do_thread_stop ();
+        do_thread_delete ();
+        do_trace_write ();
+        do_profile_write ();
 
         do_module_finalize ();
         do_module_delete ();
@@ -86,34 +142,271 @@ namespace Scaffold
 
     int Application::exec ()
     {
+        // set up dispatching threads, so modules can initialize on them
+        do_thread_start ();
+
         do_module_initialize ();
 
         // set up shared state
         app_->state = Framework::AppState::RUNNING;
 
-        // set up dispatching thread
-        thread_.start ();
-
         return QApplication::exec ();
     }
 
     void Application::update ()
     {
-        // get real-time delta value
-        frame_delta_t delta = time_.elapsed();
+        usec_t now = Clock::now ();
+
+        // free running: one tick per pass, as soon as possible
+        if (!step_)
+        {
+            do_tick (now - last_frame_);
+            last_frame_ = now;
+
+            frame_timer_.start (0); 
+            return;
+        }
+
+        // fixed step: run every tick that has come due, within reason
+        int ticks = 0;
+        while (now >= next_tick_ && ticks++ < APPLICATION_MAX_CATCHUP)
+        {
+            do_tick (step_);
+            next_tick_ += step_;
+        }
+
+        // too far behind to catch up; drop the backlog
+        if (now >= next_tick_)
+            next_tick_ = now + step_;
+
+        last_frame_ = now;
+
+        // sleep until the next tick; round up, since waking early just 
+        // costs another pass through the event loop
+        usec_t wait = std::max (next_tick_ - Clock::now (), (usec_t) 0);
+        frame_timer_.start ((wait + 999) / 1000);
+    }
+
+    void Application::do_tick (usec_t elapsed)
+    {
+        using Framework::ProfileScope;
+
+        // carry the sub-msec remainder so whole-msec deltas don't drift
+        remainder_ += elapsed;
+        frame_delta_t delta = remainder_ / 1000;
+        remainder_ -= delta * 1000;
+
+        {
+            ProfileScope frame (profiler_, "frame");
 
-        app_->delta = delta;   // update subscribers
-        do_worker_pump ();      // update workers
+            {
+                ProfileScope phase (profiler_, "app-state");
 
-        // restart timer for as soon as possible
-        frame_timer_.start (0); 
-        time_.restart ();
+                app_->delta_usec = elapsed;
+                app_->delta = delta;   // update subscribers
+                app_->carried = scheduler_.carried ();
+
+                // only notify producers when the signal flips
+                bool saturated = scheduler_.saturated ();
+                if (app_->backpressure.get () != saturated)
+                    app_->backpressure = saturated;
+            }
+
+            {
+                ProfileScope phase (profiler_, "scheduler");
+
+                scheduler_.advance (delta); // fire due timers
+                scheduler_.drain (Framework::Task::MAIN_LANE, delta);
+            }
+
+            {
+                ProfileScope phase (profiler_, "pump");
+
+                do_worker_pump (delta); // update workers
+            }
+        }
+
+        if (profiler_)
+            do_profile_frame ();
     }
 
-    void Application::do_worker_pump ()
+    void Application::setFrameBudget (frame_delta_t budget)
     {
-        for_each (workers_.begin(), workers_.end(), 
-                mem_fn (&Framework::Worker::pump));
+        for_each (threads_.begin(), threads_.end(), 
+                bind (&DispatchThread::setFrameBudget, _1, budget));
+    }
+
+    void Application::setFrameRate (int hz)
+    {
+        step_ = (hz > 0)? 1000000 / hz : 0;
+
+        last_frame_ = Clock::now ();
+        next_tick_ = last_frame_ + step_;
+    }
+
+    void Application::setProfiling (const string &path)
+    {
+        if (!profiler_)
+            profiler_ = new Framework::FrameProfiler;
+
+        profile_path_ = path;
+        framework_profiler = profiler_;
+    }
+
+    void Application::do_profile_frame ()
+    {
+        profiler_->nextFrame ();
+
+        // publish a fresh summary once per window
+        if (profiler_->frames () == Framework::PROFILE_WINDOW && 
+                !(++ profiled_ % Framework::PROFILE_WINDOW))
+        {
+            std::ostringstream out;
+            profiler_->report (out);
+            app_->profile = out.str ();
+        }
+    }
+
+    void Application::do_profile_write ()
+    {
+        if (!profiler_)
+            return;
+
+        framework_profiler = 0;
+
+        if (!profile_path_.empty())
+        {
+            std::ofstream out (profile_path_.c_str());
+            profiler_->report (out);
+
+            out << "start-up to login (usec): " << app_->login_ready.get () << endl;
+        }
+
+        safe_delete (profiler_);
+    }
+
+    void Application::setParallelPump (bool enable)
+    {
+        parallel_pump_ = enable;
+    }
+
+    void Application::setQueueCapacity (int tasks, int policy)
+    {
+        scheduler_.setCapacity (tasks, policy);
+    }
+
+    void Application::setTracing (const string &path)
+    {
+        trace_path_ = path;
+        tracing_ = true;
+        scheduler_.setTracing (true);
+    }
+
+    void Application::do_trace_write ()
+    {
+        if (!tracing_)
+            return;
+
+        scheduler_.trace()->report (cerr);
+
+        if (!trace_path_.empty())
+        {
+            std::ofstream out (trace_path_.c_str());
+            scheduler_.trace()->write (out);
+        }
+    }
+
+    void Application::do_thread_start ()
+    {
+        DispatchThread::List::iterator i = threads_.begin();
+        DispatchThread::List::iterator e = threads_.end();
+        for (; i != e; ++i) (*i)->start ();
+    }
+
+    void Application::do_thread_stop ()
+    {
+        for_each (threads_.begin(), threads_.end(), 
+                mem_fn (&DispatchThread::stop));
+
+        for_each (threads_.begin(), threads_.end(), 
+                bind (&DispatchThread::wait, _1, 1000));
+    }
+
+    void Application::do_thread_delete ()
+    {
+        for_each (threads_.begin(), threads_.end(), 
+                safe_delete <DispatchThread>);
+    }
+
+    void Application::do_worker_pump (frame_delta_t delta)
+    {
+        if (parallel_pump_)
+            do_worker_pump_parallel (delta);
+        else
+            for_each (workers_.begin(), workers_.end(), 
+                    mem_fn (&Framework::Worker::pump));
+    }
+
+    static int pump_joined (frame_delta_t)
+    {
+        return Framework::Task::SUCCESS;
+    }
+
+    void Application::do_worker_pump_parallel (frame_delta_t delta)
+    {
+        using namespace Framework;
+        typedef std::map <Worker *, Task *> JoinMap;
+
+        // each worker's tasks fan in to a join its dependants start after
+        JoinMap joins;
+        Worker::List::iterator i = workers_.begin();
+        Worker::List::iterator e = workers_.end();
+        for (; i != e; ++i)
+            joins [*i] = new Task (&pump_joined);
+
+        Task::List ready, all;
+
+        for (i = workers_.begin(); i != e; ++i)
+        {
+            Task *join = joins [*i];
+            Task::List tasks;
+            (*i)->pumpTasks (tasks);
+
+            // an empty pump still joins, so dependants aren't held up
+            if (tasks.empty())
+                tasks.push_back (join);
+            else
+                for_each (tasks.begin(), tasks.end(), bind (&Task::chain, _1, join));
+
+            const Worker::List &deps = (*i)->dependencies ();
+            int waits = 0;
+
+            Task::List::iterator t = tasks.begin();
+            for (; t != tasks.end(); ++t)
+            {
+                Worker::List::const_iterator d = deps.begin();
+                for (; d != deps.end(); ++d)
+                    if (joins.count (*d))
+                        (*t)->after (joins [*d]), ++waits;
+            }
+
+            if (!waits)
+                ready.insert (ready.end(), tasks.begin(), tasks.end());
+
+            all.insert (all.end(), tasks.begin(), tasks.end());
+            all.push_back (join);
+        }
+
+        all.sort ();
+        all.unique ();
+        for_each (all.begin(), all.end(), bind (&Task::within, _1, &pump_tasks_));
+
+        scheduler_.enqueue (ready);
+
+        // the frame still ends with the pump, so lend a hand until it does
+        while (pump_tasks_.length ())
+            if (!scheduler_.drain (Task::MAIN_LANE, delta) && !scheduler_.help (&pump_tasks_, delta))
+                pump_tasks_.wait (1);
     }
 
     void Application::do_worker_delete ()
@@ -124,8 +417,43 @@ namespace Scaffold
 
     void Application::do_module_initialize ()
     {
-        for_each (modules_.begin(), modules_.end(), 
-                bind (&Framework::Module::initialize, _1, &scheduler_));
+        using namespace Framework;
+        typedef std::map <Module *, Task *> InitMap;
+
+        InitMap inits;
+        Module::List::iterator i = modules_.begin();
+        Module::List::iterator e = modules_.end();
+        for (; i != e; ++i)
+            inits [*i] = new Task (bind (&Module::initialize_task, *i, &scheduler_, _1), 
+                    Task::CRITICAL, (*i)->affinity ());
+
+        Task::List ready;
+
+        for (i = modules_.begin(); i != e; ++i)
+        {
+            Task *init = inits [*i];
+            init->named ("module-initialize");
+            init->within (&module_tasks_);
+
+            const Module::List &deps = (*i)->dependencies ();
+            int waits = 0;
+
+            // modules that were never attached aren't waited on
+            Module::List::const_iterator d = deps.begin();
+            for (; d != deps.end(); ++d)
+                if (inits.count (*d))
+                    init->after (inits [*d]), ++waits;
+
+            if (!waits)
+                ready.push_back (init);
+        }
+
+        scheduler_.enqueue (ready);
+
+        // start-up ends once every module is up, so lend a hand until then
+        while (module_tasks_.length ())
+            if (!scheduler_.drain (Task::MAIN_LANE, 0) && !scheduler_.help (&module_tasks_, 0))
+                module_tasks_.wait (1);
     }
 
     void Application::do_module_finalize ()
@@ -145,19 +473,21 @@ namespace Scaffold
         using namespace Model;
         using namespace Framework;
 
-        const char *app_archetypes[] = { "application-archetype" };
+        Tag::Set app_archetypes;
+        app_archetypes.insert (APPLICATION_ARCHETYPE);
 
         model_entity_factory->attach
             (new ComponentFactory <AppState>
-             ("application-state-component", app_archetypes, 1));
+             (APPLICATION_STATE_COMPONENT, app_archetypes));
 
         model_entity_factory->attach
             (new ComponentFactory <WorldState>
-             ("application-worldstate-component", app_archetypes, 1));
+             (APPLICATION_WORLDSTATE_COMPONENT, app_archetypes));
 
-        Entity *app = model_entity_factory->create ("application", "application-archetype");
-        app_ = app->get <AppState> ("application-state-component");
-        world_ = app->get <WorldState> ("application-worldstate-component");
+        Entity *app = model_entity_factory->create 
+            (*APPLICATION_ENTITY.name, *APPLICATION_ARCHETYPE.name);
+        app_ = app->get <AppState> (APPLICATION_STATE_COMPONENT);
+        world_ = app->get <WorldState> (APPLICATION_WORLDSTATE_COMPONENT);
         model_entities->insert (app);
     }
 }
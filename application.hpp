@@ -10,9 +10,11 @@
 #include <QApplication>
 #include <QThread>
 #include <QTimer>
-#include <QTime>
 
 #include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
 #include "task.hpp"
 #include "module.hpp"
 #include "model.hpp"
@@ -20,6 +22,22 @@
 
 namespace Scaffold
 {
+    // simulation ticks per second until setFrameRate says otherwise; 0 
+    // runs frames back to back with real-time deltas, so fixed steps are 
+    // opt-in
+    const int APPLICATION_FRAME_RATE (0);
+
+    // ticks run back to back to catch up after a stall, before the 
+    // backlog is dropped
+    const int APPLICATION_MAX_CATCHUP (4);
+
+    // the application entity and its components; hashed once at start-up, 
+    // so lookups don't build a Tag from a literal each time
+    const Tag APPLICATION_ENTITY ("application");
+    const Tag APPLICATION_ARCHETYPE ("application-archetype");
+    const Tag APPLICATION_STATE_COMPONENT ("application-state-component");
+    const Tag APPLICATION_WORLDSTATE_COMPONENT ("application-worldstate-component");
+
     namespace Framework
     {
         // share application state through application entity
@@ -38,11 +56,33 @@ namespace Scaffold
             AppState (const Tag &id) :
                 Model::Component (id), 
                 state ("application-state", INITIAL),
-                delta ("frame-duration")
+                delta ("frame-duration"),
+                delta_usec ("frame-duration-usec", 0),
+                carried ("scheduler-carried", 0),
+                backpressure ("scheduler-backpressure", false),
+                profile ("frame-profile", ""),
+                started ("application-started", Clock::now ()),
+                login_ready ("application-login-ready", 0)
             {}
 
             Model::Property <int> state;
             Model::Property <frame_delta_t> delta;
+            Model::Property <usec_t> delta_usec;
+            Model::Property <int> carried;
+
+            // set while the scheduler's queue is near capacity; producers
+            // should slow their intake until it clears
+            Model::Property <bool> backpressure;
+
+            // per-phase frame time summary, refreshed while profiling
+            Model::Property <string> profile;
+
+            // when start-up began, for measuring how long it takes
+            Model::Property <usec_t> started;
+
+            // usec from start-up until the login screen is up or, headless,
+            // the login goes out; 0 until then
+            Model::Property <usec_t> login_ready;
         };
 
         // share in-world state through application entity
@@ -71,34 +111,52 @@ namespace Scaffold
     }
 
     // run blocking module code one a separate thread
+    // each thread drains one worker slot of the scheduler, optionally
+    // spending no more than a fixed budget of each frame
     class DispatchThread : public QThread
     {
         Q_OBJECT
 
         public:
-            DispatchThread ();
+            typedef std::vector <DispatchThread *> List;
+
+            DispatchThread (int worker = 0);
 
             void setScheduler (Framework::Scheduler *s);
             void setFrameDelta (frame_delta_t t);
+            void setFrameBudget (frame_delta_t t);
 
             void run ();
             void stop ();
 
+        private:
+            void dispatch_budgeted_ ();
+            void wait_frame_ (int frame);
+
         private:
             Framework::Scheduler  *scheduler_;
 
+            int             worker_;
             frame_delta_t   delta_;
+            frame_delta_t   budget_;
+            frame_delta_t   spent_;
+            int             last_frame_;
             bool            stop_;
+
+            Atomic      frame_;
+            Mutex       frame_lock_;
+            Condition   frame_tick_;
     };
 
     // combine main-loop, modules, workers, scheduler, and application entity
     // application entity is named "application"
+    // without gui, Qt runs console-only and never connects to a display
     class Application : public QApplication
     {
         Q_OBJECT
 
         public:
-            Application (int &argc, char **argv);
+            Application (int &argc, char **argv, int workers = 1, bool gui = true);
             ~Application ();
 
         public:
@@ -107,11 +165,44 @@ namespace Scaffold
 
             int exec ();
 
+            // 0 disables; otherwise per-thread dispatch time per frame
+            void setFrameBudget (frame_delta_t budget);
+
+            // fixed simulation ticks per second, sleeping in between; 
+            // 0 runs frames back to back with real-time deltas
+            void setFrameRate (int hz);
+
+            // time frame phases; summaries go to AppState::profile, and 
+            // on exit to path, if one is given
+            void setProfiling (const string &path);
+
+            // pump workers and their providers as tasks on the scheduler, 
+            // honouring lane affinity and declared worker dependencies
+            void setParallelPump (bool enable);
+
+            // bound the scheduler's injection queue; 0 leaves it unbounded
+            void setQueueCapacity (int tasks, int policy = Framework::Scheduler::BLOCK);
+
+            // trace scheduled tasks; on exit a summary goes to stderr and
+            // chrome://tracing json to path, if one is given
+            void setTracing (const string &path);
+
             protected slots:
                 void update ();
 
         private:
-            void do_worker_pump ();
+            void do_tick (usec_t delta);
+
+            void do_thread_start ();
+            void do_thread_stop ();
+            void do_thread_delete ();
+
+            void do_trace_write ();
+            void do_profile_frame ();
+            void do_profile_write ();
+
+            void do_worker_pump (frame_delta_t delta);
+            void do_worker_pump_parallel (frame_delta_t delta);
             void do_worker_delete ();
 
             void do_module_initialize ();
@@ -127,10 +218,21 @@ namespace Scaffold
             Framework::AppState     *app_;
             Framework::WorldState   *world_;
             Framework::Scheduler    scheduler_;
-            DispatchThread          thread_;
+            DispatchThread::List    threads_;
+            string                  trace_path_;
+            bool                    tracing_;
+            bool                    parallel_pump_;
+            Framework::TaskGroup    pump_tasks_;
+            Framework::TaskGroup    module_tasks_;
+            Framework::FrameProfiler *profiler_;
+            string                  profile_path_;
+            int                     profiled_;
 
             QTimer  frame_timer_;
-            QTime   time_;
+            usec_t  step_;
+            usec_t  last_frame_;
+            usec_t  next_tick_;
+            usec_t  remainder_;
     };
 }
 
@@ -0,0 +1,72 @@
+/* bench.hpp -- threads shared by the benchmarks
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+namespace Scaffold
+{
+    // runs one function on a thread of its own
+    class BenchThread : public QThread
+    {
+        public:
+            BenchThread (const function <void()> &work) : 
+                work_ (work) 
+            {}
+
+            void run () 
+            { 
+                work_ (); 
+            }
+
+        private:
+            function <void()>     work_;
+    };
+
+    // a dispatch loop per worker, as Application's threads run them but
+    // without frame budgets; stopped and joined when it goes out of scope
+    class BenchWorkers
+    {
+        public:
+            BenchWorkers (Framework::Scheduler &s, int count) : 
+                scheduler_ (s), stop_ (false)
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    threads_.push_back (new BenchThread (bind (&BenchWorkers::dispatch_, this, i)));
+                    threads_.back()->start ();
+                }
+            }
+
+            ~BenchWorkers ()
+            {
+                stop_ = true;
+                scheduler_.wake ();
+
+                for (size_t i = 0; i < threads_.size(); ++i)
+                {
+                    threads_ [i]->wait ();
+                    delete threads_ [i];
+                }
+            }
+
+        private:
+            void dispatch_ (int worker)
+            {
+                while (!stop_)
+                {
+                    while (!stop_ && scheduler_.dispatch (worker, 0));
+                    if (!stop_) scheduler_.wait (worker);
+                }
+            }
+
+        private:
+            Framework::Scheduler            &scheduler_;
+            volatile bool                   stop_;
+            std::vector <BenchThread *>     threads_;
+    };
+}
+
+#endif //BENCH_H_
@@ -0,0 +1,108 @@
+/* idle.cpp -- idle cpu use and wake latency of scheduler dispatch threads
+ *
+ *			Ryan McDougall
+ */
+
+#include <QThread>
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
+#include "task.hpp"
+#include "bench/bench.hpp"
+
+using namespace Scaffold;
+using namespace Scaffold::Framework;
+
+// dispatch threads, quiet time measured, and wake-ups sampled
+const int BENCH_WORKERS (4);
+const int BENCH_IDLE_MSEC (2000);
+const int BENCH_WAKES (200);
+
+// long enough between wake-ups that every worker is asleep again
+const int BENCH_WAKE_GAP (5);
+
+static Atomic woken;
+
+static int stamp (usec_t *ran, frame_delta_t)
+{
+    *ran = Clock::now ();
+    woken.ref ();
+    return Task::SUCCESS;
+}
+
+// holds a worker so work pinned behind it sits in the mailbox
+static int hold (int msec, frame_delta_t)
+{
+    QThread::msleep (msec);
+    return Task::SUCCESS;
+}
+
+static double idle_cpu (int msec)
+{
+    std::clock_t cpu = std::clock ();
+    usec_t wall = Clock::now ();
+
+    QThread::msleep (msec);
+
+    double used = double (std::clock () - cpu) / CLOCKS_PER_SEC;
+    return 100.0 * used / ((Clock::now () - wall) / 1e6);
+}
+
+static void wake_latency (Scheduler &scheduler, int lane, Histogram &latency)
+{
+    for (int i = 0; i < BENCH_WAKES; ++i)
+    {
+        QThread::msleep (BENCH_WAKE_GAP);
+
+        usec_t ran = 0;
+        int target = woken + 1;
+        usec_t sent = Clock::now ();
+
+        scheduler.enqueue (new Task (bind (&stamp, &ran, _1), Task::NORMAL, lane));
+
+        while (woken < target)
+            QThread::yieldCurrentThread ();
+
+        latency.record (ran - sent);
+    }
+}
+
+static void report (const char *what, const Histogram &h)
+{
+    cout << what << " (usec): p50 " << h.percentile (50)
+        << " p95 " << h.percentile (95) << " p99 " << h.percentile (99)
+        << " max " << h.max () << endl;
+}
+
+int main ()
+{
+    Scheduler scheduler (BENCH_WORKERS);
+    BenchWorkers workers (scheduler, BENCH_WORKERS);
+
+    // let the workers settle into their idle waits
+    QThread::msleep (100);
+
+    cout << BENCH_WORKERS << " idle workers, cpu: "
+        << idle_cpu (BENCH_IDLE_MSEC) << "% of one core" << endl;
+
+    // the other workers have nothing they may run, so they should stay asleep
+    scheduler.enqueue (new Task (bind (&hold, BENCH_IDLE_MSEC + 100, _1), Task::NORMAL, 0));
+    scheduler.enqueue (new Task (bind (&hold, 0, _1), Task::NORMAL, 0));
+    QThread::msleep (50);
+
+    cout << BENCH_WORKERS - 1 << " idle workers beside a busy lane with mail waiting, cpu: "
+        << idle_cpu (BENCH_IDLE_MSEC) << "% of one core" << endl;
+
+    QThread::msleep (100);
+
+    Histogram latency, pinned;
+    wake_latency (scheduler, Task::ANY_LANE, latency);
+    report ("wake latency", latency);
+
+    wake_latency (scheduler, BENCH_WORKERS - 1, pinned);
+    report ("pinned wake latency", pinned);
+
+    return 0;
+}
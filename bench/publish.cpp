@@ -0,0 +1,181 @@
+/* publish.cpp -- publish throughput of subscriptions and property changes
+ *
+ *			Ryan McDougall
+ */
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "tag.hpp"
+#include "subscription.hpp"
+#include "component.hpp"
+#include "entity.hpp"
+
+using namespace Scaffold;
+using namespace Scaffold::Model;
+
+// publishes per measurement
+const int BENCH_PUBLISHES (2000000);
+
+// the property chain as it was before subscriptions held delegates: 
+// each hop a bare list of function <> holding a bind to the next, and 
+// a set publishing the same four notices
+namespace Before
+{
+    template <typename T>
+        struct Subscription
+        {
+            void operator() (T arg) const
+            {
+                typename std::vector <std::tr1::function <void(T)> >::const_iterator i = subscribers.begin();
+                typename std::vector <std::tr1::function <void(T)> >::const_iterator e = subscribers.end();
+                for (; i != e; ++i) (*i) (arg);
+            }
+
+            std::vector <std::tr1::function <void(T)> > subscribers;
+        };
+
+    struct Property
+    {
+        Property () : value (0) {}
+
+        void set (int v)
+        {
+            value = v;
+            on_access (this);
+            on_change (this);
+            on_value_access (value);
+            on_value_change (value);
+        }
+
+        Subscription <void *> on_access;
+        Subscription <void *> on_change;
+        Subscription <int> on_value_access;
+        Subscription <int> on_value_change;
+
+        int value;
+    };
+
+    struct Component
+    {
+        void observe (Property &prop)
+        {
+            prop.on_access.subscribers.push_back (bind (&Component::property_access, this, _1));
+            prop.on_change.subscribers.push_back (bind (&Component::property_change, this, _1));
+        }
+
+        Subscription <void *> on_access;
+        Subscription <void *> on_change;
+
+        void property_access (void *) { on_access (this); }
+        void property_change (void *) { on_change (this); }
+    };
+
+    struct Entity
+    {
+        void observe (Component &comp)
+        {
+            comp.on_access.subscribers.push_back (bind (&Entity::component_access, this, _1));
+            comp.on_change.subscribers.push_back (bind (&Entity::component_change, this, _1));
+        }
+
+        Subscription <Entity *> on_access;
+        Subscription <Entity *> on_change;
+
+        void component_access (void *) { on_access (this); }
+        void component_change (void *) { on_change (this); }
+    };
+}
+
+struct Sink
+{
+    Sink () : total (0) {}
+
+    void add (int v) { total += v; }
+    void add_scaled (int scale, int v) { total += scale * v; }
+    void touch (Entity *) { ++ total; }
+    void touch_before (Before::Entity *) { ++ total; }
+
+    long total;
+};
+
+// a bare loop over function <>, with none of a subscription's safety
+// during dispatch; the floor its overhead is measured against
+typedef std::vector <std::tr1::function <void(int)> > FunctionList;
+
+static void publish (const FunctionList &list, int v)
+{
+    FunctionList::const_iterator i = list.begin();
+    FunctionList::const_iterator e = list.end();
+    for (; i != e; ++i) (*i) (v);
+}
+
+template <typename Publish>
+static double time_publish (Publish p)
+{
+    usec_t start = Clock::now ();
+
+    for (int i = 0; i < BENCH_PUBLISHES; ++i)
+        p (i);
+
+    return (Clock::now () - start) * 1000.0 / BENCH_PUBLISHES;
+}
+
+static void publish_delegates (const Subscription <void(int)> *s, int v) { (*s) (v); }
+static void publish_functions (const FunctionList *s, int v) { publish (*s, v); }
+static void publish_property (Property <int> *p, int v) { p->set (v); }
+static void publish_before (Before::Property *p, int v) { p->set (v); }
+
+int main ()
+{
+    static const int counts [] = { 1, 4, 16 };
+    Sink sink;
+
+    cout << "nsec per publish" << endl;
+
+    for (size_t c = 0; c < sizeof (counts) / sizeof (counts [0]); ++c)
+    {
+        Subscription <void(int)> methods, binds;
+        FunctionList functions, bound;
+
+        for (int i = 0; i < counts [c]; ++i)
+        {
+            methods.subscribe (&sink, &Sink::add);
+            binds += bind (&Sink::add_scaled, &sink, i, _1);
+            functions.push_back (bind (&Sink::add, &sink, _1));
+            bound.push_back (bind (&Sink::add_scaled, &sink, i, _1));
+        }
+
+        cout << "  " << counts [c] << " subscriber(s): method "
+            << time_publish (bind (&publish_delegates, &methods, _1))
+            << " (function <> " << time_publish (bind (&publish_functions, &functions, _1))
+            << "), bind " << time_publish (bind (&publish_delegates, &binds, _1))
+            << " (function <> " << time_publish (bind (&publish_functions, &bound, _1))
+            << ")" << endl;
+    }
+
+    // a property change travels up to its component and entity
+    Property <int> property ("bench-property", 0);
+    Component component ("bench-component");
+    Entity entity ("bench-entity");
+
+    component.observe (property);
+    entity.observe (component);
+    entity.on_change.subscribe (&sink, &Sink::touch);
+
+    Before::Property before_property;
+    Before::Component before_component;
+    Before::Entity before_entity;
+
+    before_component.observe (before_property);
+    before_entity.observe (before_component);
+    before_entity.on_change.subscribers.push_back (bind (&Sink::touch_before, &sink, _1));
+
+    cout << "  property set, through component to entity: "
+        << time_publish (bind (&publish_property, &property, _1))
+        << " (before delegates " << time_publish (bind (&publish_before, &before_property, _1))
+        << ")" << endl;
+
+    // keeps the result live
+    return (sink.total == 42)? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/* tags.cpp -- cost of hashing names and building tags, by name length
+ *
+ *			Ryan McDougall
+ */
+
+#include <QThread>
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
+#include "task.hpp"
+#include "tag.hpp"
+#include "bench/bench.hpp"
+
+using namespace Scaffold;
+
+// tags built per measurement, and threads building them at once
+const int BENCH_TAGS (1000000);
+const int BENCH_THREADS (4);
+
+// distinct names per length, all interned before timing starts
+const int BENCH_NAMES (64);
+
+static std::vector <string> names_of_length (size_t len)
+{
+    std::vector <string> names;
+
+    for (int i = 0; i < BENCH_NAMES; ++i)
+    {
+        std::ostringstream s;
+        s << i << '-';
+
+        string name (s.str ());
+        name.resize (std::max (len, name.size ()), 'x');
+        names.push_back (name);
+    }
+
+    return names;
+}
+
+static uint64_t murmur (const string &name)
+{
+    return murmur_hash2 (name.data(), name.size(), 0);
+}
+
+static uint64_t wy (const string &name)
+{
+    return wy_hash (name.data(), name.size(), 0);
+}
+
+// both hashes see the same names in the same order; sums the results 
+// so the loop can't be optimised away
+template <typename Hash>
+static double time_hash (const std::vector <string> &names, Hash hash, uint64_t &sum)
+{
+    usec_t start = Clock::now ();
+
+    for (int i = 0; i < BENCH_TAGS; ++i)
+        sum += hash (names [i % BENCH_NAMES]);
+
+    return (Clock::now () - start) * 1000.0 / BENCH_TAGS;
+}
+
+// sums the numbers so the loop can't be optimised away
+static tag_t build (const std::vector <string> &names, int count)
+{
+    tag_t sum = 0;
+
+    for (int i = 0; i < count; ++i)
+        sum += Tag (names [i % BENCH_NAMES].c_str ()).number;
+
+    return sum;
+}
+
+static void build_into (const std::vector <string> *names, tag_t *sum)
+{
+    *sum = build (*names, BENCH_TAGS);
+}
+
+static double threaded (const std::vector <string> &names, tag_t &sum)
+{
+    std::vector <BenchThread *> threads;
+    tag_t sums [BENCH_THREADS];
+
+    usec_t start = Clock::now ();
+
+    for (int i = 0; i < BENCH_THREADS; ++i)
+    {
+        threads.push_back (new BenchThread (bind (&build_into, &names, &sums [i])));
+        threads.back()->start ();
+    }
+
+    for (int i = 0; i < BENCH_THREADS; ++i)
+    {
+        threads [i]->wait ();
+        sum += sums [i];
+        delete threads [i];
+    }
+
+    // wall time over every tag built, so contention shows as a rise
+    return (Clock::now () - start) * 1000.0 / (BENCH_TAGS * BENCH_THREADS);
+}
+
+int main ()
+{
+    static const size_t lengths [] = { 4, 8, 16, 32, 64, 128 };
+    tag_t sum = 0;
+    uint64_t hashed = 0;
+
+    cout << "nsec per name hashed, then per "
+        << sizeof (tag_t) * 8 << "-bit tag of an existing name" << endl;
+
+    for (size_t l = 0; l < sizeof (lengths) / sizeof (lengths [0]); ++l)
+    {
+        std::vector <string> names (names_of_length (lengths [l]));
+        build (names, BENCH_NAMES);
+
+        double murmur_time = time_hash (names, &murmur, hashed);
+        double wy_time = time_hash (names, &wy, hashed);
+
+        usec_t start = Clock::now ();
+        sum += build (names, BENCH_TAGS);
+        double one = (Clock::now () - start) * 1000.0 / BENCH_TAGS;
+
+        double many = threaded (names, sum);
+
+        cout << "  length " << lengths [l] << ": murmur2 " << murmur_time 
+            << ", wyhash " << wy_time << "; tag " << one << " on one thread, "
+            << many << " across " << BENCH_THREADS << endl;
+    }
+
+    // keeps the results live
+    return (sum == 42 && hashed == 42)? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/* tasks.cpp -- scheduler throughput and heap traffic per task
+ *
+ *			Ryan McDougall
+ */
+
+#include <QThread>
+#include <new>
+#include <cstdlib>
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
+#include "task.hpp"
+#include "bench/bench.hpp"
+
+using namespace Scaffold;
+using namespace Scaffold::Framework;
+
+// tasks per round, rounds run before measuring, and dispatch threads
+const int BENCH_TASKS (100000);
+const int BENCH_WARMUP (2);
+const int BENCH_WORKERS (4);
+
+// every trip through the global allocator, so steady state traffic shows
+static Atomic allocations;
+
+void *operator new (size_t size) throw (std::bad_alloc)
+{
+    allocations.ref ();
+
+    void *p = std::malloc (size? size : 1);
+    if (!p) throw std::bad_alloc ();
+
+    return p;
+}
+
+void operator delete (void *p) throw ()
+{
+    std::free (p);
+}
+
+static Atomic done;
+
+static int finish (frame_delta_t)
+{
+    done.ref ();
+    return Task::SUCCESS;
+}
+
+// goes once round the injection queue before finishing
+static int yield_once (bool *yielded, frame_delta_t)
+{
+    if (*yielded)
+        return finish (0);
+
+    *yielded = true;
+    return Task::YIELD;
+}
+
+struct Round
+{
+    double  rate;
+    double  allocs;
+};
+
+template <typename Make>
+static Round round (Scheduler &scheduler, int workers, Make make)
+{
+    done = 0;
+    int before = allocations;
+    usec_t start = Clock::now ();
+
+    for (int i = 0; i < BENCH_TASKS; ++i)
+        scheduler.enqueue (make (i));
+
+    // with no dispatch threads the caller is the only worker
+    if (!workers)
+        while (scheduler.dispatch (0, 0));
+
+    while (done < BENCH_TASKS)
+        QThread::yieldCurrentThread ();
+
+    usec_t elapsed = Clock::now () - start;
+
+    Round r = { BENCH_TASKS / (elapsed / 1e6),
+        double (allocations - before) / BENCH_TASKS };
+    return r;
+}
+
+static Task *make_plain (int)
+{
+    return new Task (&finish);
+}
+
+static bool yielded [BENCH_TASKS];
+
+static Task *make_yield (int i)
+{
+    yielded [i] = false;
+    return new Task (bind (&yield_once, &yielded [i], _1));
+}
+
+template <typename Make>
+static void measure (const char *what, int workers, Make make)
+{
+    Scheduler scheduler (workers? workers : 1);
+    BenchWorkers threads (scheduler, workers);
+
+    // first rounds fill the task pool and grow the deques
+    for (int i = 0; i < BENCH_WARMUP; ++i)
+        round (scheduler, workers, make);
+
+    Round r = round (scheduler, workers, make);
+
+    cout << what << ", " << (workers? workers : 1) << " worker(s): "
+        << int (r.rate) << " tasks/sec, "
+        << r.allocs << " heap allocations per task" << endl;
+}
+
+int main ()
+{
+    measure ("inject and run", 0, &make_plain);
+    measure ("inject, yield and run", 0, &make_yield);
+    measure ("inject and run", BENCH_WORKERS, &make_plain);
+    measure ("inject, yield and run", BENCH_WORKERS, &make_yield);
+
+    return 0;
+}
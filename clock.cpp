@@ -0,0 +1,28 @@
+/* clock.cpp -- monotonic high resolution time source
+ *
+ *			Ryan McDougall
+ */
+
+#include <QElapsedTimer>
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+
+//=============================================================================
+//
+namespace Scaffold
+{
+    // started during static initialization, before any thread asks the time
+    static struct Epoch
+    {
+        Epoch () { timer.start (); }
+
+        QElapsedTimer timer;
+    } 
+    epoch;
+
+    usec_t Clock::now ()
+    {
+        return epoch.timer.nsecsElapsed () / 1000;
+    }
+}
@@ -0,0 +1,20 @@
+/* clock.hpp -- monotonic high resolution time source
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+namespace Scaffold
+{
+    typedef int64_t usec_t;
+
+    struct Clock
+    {
+        // microseconds since an arbitrary, fixed epoch; never goes backwards
+        static usec_t now ();
+    };
+}
+
+#endif //CLOCK_H_
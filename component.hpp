@@ -90,10 +90,8 @@ namespace Scaffold
 
                 void observe (PropertyBase &prop)
                 {
-                    using namespace std::tr1::placeholders;
-
-                    prop.on_access += bind (&Component::property_access_, this, _1);
-                    prop.on_change += bind (&Component::property_change_, this, _1);
+                    prop.on_access.subscribe (this, &Component::property_access_);
+                    prop.on_change.subscribe (this, &Component::property_change_);
                 }
 
             public:
@@ -0,0 +1,242 @@
+/* delegate.hpp -- callable wrapper with inline small-object storage
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef DELEGATE_H_
+#define DELEGATE_H_
+
+namespace Scaffold
+{
+    // functors up to this size are stored in place rather than on the heap
+    const size_t DELEGATE_INLINE_SIZE (6 * sizeof (void *));
+
+    // storage and lifetime shared by delegates of every signature; each
+    // signature adds a direct pointer to its own invoker, so a call costs
+    // one indirect jump
+    class DelegateBase
+    {
+        protected:
+            union Storage
+            {
+                void    *heap;
+                double  align;
+                char    buffer [DELEGATE_INLINE_SIZE];
+            };
+
+            struct Lifetime
+            {
+                void (*clone) (Storage &, const Storage &);
+                void (*destroy) (Storage &);
+            };
+
+            template <typename T, bool Small =
+                (sizeof (T) <= sizeof (Storage)) &&
+                (std::tr1::alignment_of <T>::value <= std::tr1::alignment_of <Storage>::value)>
+                struct Manager
+                {
+                    static T *get (const Storage &s) { return (T *) s.buffer; }
+                    static void create (Storage &s, const T &f) { new (s.buffer) T (f); }
+                    static void clone (Storage &d, const Storage &s) { new (d.buffer) T (*get (s)); }
+                    static void destroy (Storage &s) { get (s)->~T (); }
+
+                    static const Lifetime *table ()
+                    {
+                        static const Lifetime life = { &clone, &destroy };
+                        return &life;
+                    }
+                };
+
+            template <typename T>
+                struct Manager <T, false>
+                {
+                    static T *get (const Storage &s) { return (T *) s.heap; }
+                    static void create (Storage &s, const T &f) { s.heap = new T (f); }
+                    static void clone (Storage &d, const Storage &s) { d.heap = new T (*get (s)); }
+                    static void destroy (Storage &s) { delete get (s); }
+
+                    static const Lifetime *table ()
+                    {
+                        static const Lifetime life = { &clone, &destroy };
+                        return &life;
+                    }
+                };
+
+            // binds an object to one of its methods without a bind object,
+            // so it always fits in place
+            template <typename C, typename M>
+                struct Method
+                {
+                    Method (C *o, M m) : object (o), method (m) {}
+
+                    C   *object;
+                    M   method;
+                };
+
+        public:
+            bool empty () const
+            {
+                return !life_;
+            }
+
+        protected:
+            DelegateBase () : life_ (0) {}
+
+            DelegateBase (const DelegateBase &r) : life_ (r.life_)
+            {
+                if (life_) life_->clone (storage_, r.storage_);
+            }
+
+            ~DelegateBase ()
+            {
+                if (life_) life_->destroy (storage_);
+            }
+
+            DelegateBase &operator= (const DelegateBase &r)
+            {
+                if (this != &r)
+                {
+                    if (life_) life_->destroy (storage_);
+                    life_ = r.life_;
+                    if (life_) life_->clone (storage_, r.storage_);
+                }
+
+                return *this;
+            }
+
+            template <typename T>
+                void create_ (const T &f)
+                {
+                    life_ = Manager <T>::table ();
+                    Manager <T>::create (storage_, f);
+                }
+
+        protected:
+            const Lifetime  *life_;
+            mutable Storage storage_;
+    };
+
+    // calls a functor, dropping its result for void signatures as function <> does
+    template <typename R>
+        struct DelegateCall
+        {
+            template <typename T, typename A1>
+                static R call (T &f, A1 a1) { return f (a1); }
+
+            template <typename T, typename A1, typename A2>
+                static R call (T &f, A1 a1, A2 a2) { return f (a1, a2); }
+        };
+
+    template <>
+        struct DelegateCall <void>
+        {
+            template <typename T, typename A1>
+                static void call (T &f, A1 a1) { f (a1); }
+
+            template <typename T, typename A1, typename A2>
+                static void call (T &f, A1 a1, A2 a2) { f (a1, a2); }
+        };
+
+    template <typename F>
+        class Delegate;
+
+    template <typename R, typename A1>
+        class Delegate <R (A1)> : public DelegateBase
+        {
+            public:
+                Delegate () : invoke_ (0) {}
+
+                template <typename T>
+                    Delegate (T f) : invoke_ (&call_ <T>)
+                    {
+                        create_ (f);
+                    }
+
+                template <typename C>
+                    Delegate (C *object, R (C::*method) (A1)) :
+                        invoke_ (&method_ <C, R (C::*) (A1)>)
+                    {
+                        create_ (Method <C, R (C::*) (A1)> (object, method));
+                    }
+
+                template <typename C>
+                    Delegate (C *object, R (C::*method) (A1) const) :
+                        invoke_ (&method_ <C, R (C::*) (A1) const>)
+                    {
+                        create_ (Method <C, R (C::*) (A1) const> (object, method));
+                    }
+
+                R operator() (A1 a1) const
+                {
+                    return invoke_ (storage_, a1);
+                }
+
+            private:
+                template <typename T>
+                    static R call_ (Storage &s, A1 a1)
+                    {
+                        return DelegateCall <R>::template call <T, A1> (*Manager <T>::get (s), a1);
+                    }
+
+                template <typename C, typename M>
+                    static R method_ (Storage &s, A1 a1)
+                    {
+                        Method <C, M> *m = Manager <Method <C, M> >::get (s);
+                        return (m->object->*m->method) (a1);
+                    }
+
+            private:
+                R (*invoke_) (Storage &, A1);
+        };
+
+    template <typename R, typename A1, typename A2>
+        class Delegate <R (A1, A2)> : public DelegateBase
+        {
+            public:
+                Delegate () : invoke_ (0) {}
+
+                template <typename T>
+                    Delegate (T f) : invoke_ (&call_ <T>)
+                    {
+                        create_ (f);
+                    }
+
+                template <typename C>
+                    Delegate (C *object, R (C::*method) (A1, A2)) :
+                        invoke_ (&method_ <C, R (C::*) (A1, A2)>)
+                    {
+                        create_ (Method <C, R (C::*) (A1, A2)> (object, method));
+                    }
+
+                template <typename C>
+                    Delegate (C *object, R (C::*method) (A1, A2) const) :
+                        invoke_ (&method_ <C, R (C::*) (A1, A2) const>)
+                    {
+                        create_ (Method <C, R (C::*) (A1, A2) const> (object, method));
+                    }
+
+                R operator() (A1 a1, A2 a2) const
+                {
+                    return invoke_ (storage_, a1, a2);
+                }
+
+            private:
+                template <typename T>
+                    static R call_ (Storage &s, A1 a1, A2 a2)
+                    {
+                        return DelegateCall <R>::template call <T, A1, A2> (*Manager <T>::get (s), a1, a2);
+                    }
+
+                template <typename C, typename M>
+                    static R method_ (Storage &s, A1 a1, A2 a2)
+                    {
+                        Method <C, M> *m = Manager <Method <C, M> >::get (s);
+                        return (m->object->*m->method) (a1, a2);
+                    }
+
+            private:
+                R (*invoke_) (Storage &, A1, A2);
+        };
+}
+
+#endif //DELEGATE_H_
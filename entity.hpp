@@ -49,10 +49,8 @@ namespace Scaffold
             public:
                 void observe (Component &comp)
                 {
-                    using namespace std::tr1::placeholders;
-
-                    comp.on_access += bind (&Entity::component_access_, this, _1);
-                    comp.on_change += bind (&Entity::component_change_, this, _1);
+                    comp.on_access.subscribe (this, &Entity::component_access_);
+                    comp.on_change.subscribe (this, &Entity::component_change_);
                 }
 
             public:
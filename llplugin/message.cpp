@@ -13,6 +13,7 @@
 #include <cstring>
 
 #include "stdheaders.hpp"
+#include "delegate.hpp"
 #include "subscription.hpp"
 #include "llplugin/message.hpp"
 
@@ -744,14 +745,10 @@ namespace LLPlugin
     //=============================================================================
     // Message factory
 
-    MessageFactory::MessageFactory () : 
-        error_ (false), 
-        parser_ ("message_template.msg")
+    MessageFactory::MessageFactory ()
     {
         using std::make_heap;
 
-        error_ = parser_.parse (info_);
-
         for (int i=0; i < MESSAGE_POOL_SIZE; ++i)
             free_.push_back (new ByteBuffer (MAX_MESSAGE_SIZE));
 
@@ -764,6 +761,12 @@ namespace LLPlugin
         for_each (used_.begin(), used_.end(), mem_fn (&ByteBuffer::dispose));
     }
 
+    MessageFactory &MessageFactory::shared ()
+    {
+        static MessageFactory factory;
+        return factory;
+    }
+
     Message MessageFactory::create (uint32_t id, uint8_t flags, size_t size)
     {
         if (size == 0)
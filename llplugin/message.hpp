@@ -237,6 +237,10 @@ namespace LLPlugin
         public:
             Message create (uint32_t id = 0, uint8_t flags = 0, size_t size = 0);
 
+            // one buffer pool for every stream in the process; like the 
+            // streams themselves, main thread only
+            static MessageFactory &shared ();
+
         private:
             ByteBuffer *add_free_buffer_ (size_t size);
             ByteBuffer *next_free_buffer_ ();
@@ -246,11 +250,6 @@ namespace LLPlugin
             void set_used_buffer_ (ByteBuffer *buf);
 
         private:
-            bool        error_;
-
-            PacketInfo          info_;
-            MessageParser       parser_;
-
             ByteBuffer::Set     used_;
             ByteBuffer::Heap    free_;
     };
@@ -4,6 +4,7 @@
  */
 
 #include "stdheaders.hpp"
+#include "delegate.hpp"
 #include "subscription.hpp"
 #include "llplugin/message.hpp"
 #include "llplugin/messageid.hpp"
@@ -356,7 +356,9 @@ namespace LLPlugin
             session_->sessionparam_.capabilities = caps_->result;
 
             // update future
+            Locker mtx (session_->lock_);
             session_->connected_ = true;
+            session_->connected_wake_.wakeAll ();
         }
         else
             std::cout << "seed caps error: " << caps_->reply->error() << std::endl;
@@ -381,14 +383,35 @@ namespace LLPlugin
     //=========================================================================
     // LLStream
 
+    // message tables are the same for every stream, so build them once
+    static const Message::IDMap &shared_msg_id_map ()
+    {
+        static const Message::IDMap map (get_msg_id_map ());
+        return map;
+    }
+
+    static const Message::NameMap &shared_msg_name_map ()
+    {
+        static const Message::NameMap map (get_msg_name_map ());
+        return map;
+    }
+
+    static const char *msg_name (const Message::NameMap &names, uint32_t id)
+    {
+        Message::NameMap::const_iterator i = names.find (id);
+        return (i != names.end())? i->second.c_str() : "unknown";
+    }
+
     Stream::Stream () : 
         Connectivity::Stream ("ll-stream"), 
-        connected_ (false),
+        connected_ (false), throttled_ (false),
+        factory_ (MessageFactory::shared ()),
         udp_ (this), timer_ (this),
-        idmap_ (get_msg_id_map ()),
-        names_ (get_msg_name_map ()),
+        names_ (shared_msg_name_map ()),
+        idmap_ (shared_msg_id_map ()),
         send_sequence_ (1),
-        ack_age_ (0)
+        ack_age_ (0),
+        sent_count_ (0), received_count_ (0)
     {
         QObject::connect (&udp_, SIGNAL(hostFound()), this, SLOT(on_host_found()));
         QObject::connect (&udp_, SIGNAL(connected()), this, SLOT(on_connected()));
@@ -423,6 +446,21 @@ namespace LLPlugin
         return connected_;
     }
 
+    void Stream::setThrottled (bool throttled)
+    {
+        throttled_ = throttled;
+    }
+
+    uint64_t Stream::sent () const
+    {
+        return sent_count_;
+    }
+
+    uint64_t Stream::received () const
+    {
+        return received_count_;
+    }
+
     bool Stream::connect ()
     {
         udp_.connectToHost (QString (sessionparam_.sim_ip.c_str()), 
@@ -468,12 +506,20 @@ namespace LLPlugin
         return udp_.waitForReadyRead ();
     }
 
-    void Stream::listen (msg_id_t id, Message::Listener listen)
+    Connection Stream::listen (msg_id_t id, Message::Listener listen)
     {
         if (!subscribers_.count (id))
             subscribers_.insert (make_pair (id, Message::Signal ()));
 
-        subscribers_[id] += listen;
+        return subscribers_[id] += listen;
+    }
+
+    void Stream::unlisten (msg_id_t id, Connection c)
+    {
+        Message::SubscriptionMap::iterator i = subscribers_.find (id);
+
+        if (i != subscribers_.end())
+            i->second.disconnect (c);
     }
 
     void Stream::sendAckPacket ()
@@ -611,11 +657,7 @@ namespace LLPlugin
     {
         cout << "ready for reading" << endl;
 
-        while (udp_.hasPendingDatagrams ())
-        {
-            Message m (factory_.create ());
-            recv_message_ (m);
-        }
+        recv_pending_ ();
     }
 
     void Stream::on_bytes_written (qint64 bytes)
@@ -642,6 +684,23 @@ namespace LLPlugin
 
         // send waiting acks
         ack_process_ (msec);
+
+        // pick up what was left unread while throttled
+        if (hasMessages ())
+            recv_pending_ ();
+    }
+
+    void Stream::recv_pending_ ()
+    {
+        Framework::ProfileScope scope (framework_profiler, "stream-receive");
+
+        int limit = throttled_? STREAM_THROTTLED_READS : INT_MAX;
+
+        for (int n = 0; n < limit && udp_.hasPendingDatagrams (); ++n)
+        {
+            Message m (factory_.create ());
+            recv_message_ (m);
+        }
     }
 
     void Stream::prepare_message_ (Message &m)
@@ -662,7 +721,8 @@ namespace LLPlugin
         pair <const char *, size_t> buf = m.readBuffer ();
         int size = static_cast <int> (udp_.write (buf.first, buf.second));
 
-        cout << "send message: " << names_ [m.getID()] << endl;
+        ++ sent_count_;
+        cout << "send message: " << msg_name (names_, m.getID()) << endl;
 
         return true;
     }
@@ -738,10 +798,11 @@ namespace LLPlugin
                 m.popMsgID ();
 
             // notify listeners
+            received_count_.ref ();
             subscribers_ [m.getID()] (m);
         }
 
-        cout << "recv message: " << names_ [m.getID()] << endl;
+        cout << "recv message: " << msg_name (names_, m.getID()) << endl;
 
         return true;
     }
@@ -952,6 +1013,23 @@ namespace LLPlugin
         return logout_ ();
     }
 
+    bool Session::waitForConnected (unsigned long msec)
+    {
+        usec_t deadline = Clock::now () + msec * 1000;
+        Locker mtx (lock_);
+
+        while (!connected_)
+        {
+            usec_t now = Clock::now ();
+            if (now >= deadline)
+                break;
+
+            connected_wake_.wait (&lock_, (deadline - now) / 1000 + 1);
+        }
+
+        return connected_;
+    }
+
     //=========================================================================
     // LLSessionProvider
 
@@ -1003,21 +1081,21 @@ namespace LLPlugin
         }
     }
 
-    Connectivity::Session *SessionProvider::session ()
+    int SessionProvider::affinity () const
     {
-        return &session_;
+        // sessions own Qt sockets
+        return Framework::Task::MAIN_LANE;
     }
 
-    void SessionProvider::timerEvent (QTimerEvent *e)
+    Connectivity::Session *SessionProvider::session ()
     {
-        timeout_ = true;
+        return &session_;
     }
 
     Connectivity::Session *SessionProvider::establish_session_blocking_ ()
     { 
-        // block waiting completion
-        timeout_ = false; startTimer (5000);
-        while (!session_.isConnected () && !timeout_);
+        // the login runs on the main thread, which wakes us when it connects
+        session_.waitForConnected (SESSION_CONNECT_TIMEOUT);
 
         return session ();
     }
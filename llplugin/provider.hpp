@@ -36,6 +36,12 @@ namespace LLPlugin
     class Session;
     class SessionProvider;
 
+    // datagrams read per wakeup while throttled; the rest wait in the socket
+    const int STREAM_THROTTLED_READS (8);
+
+    // longest (msec) a login waits for the session to connect
+    const unsigned long SESSION_CONNECT_TIMEOUT (5000);
+
     //=========================================================================
     // LL Buddies
 
@@ -178,6 +184,13 @@ namespace LLPlugin
 
             bool isConnected () const;
 
+            // slow intake while downstream consumers are backed up
+            void setThrottled (bool throttled);
+
+            // messages sent and received since construction
+            uint64_t sent () const;
+            uint64_t received () const;
+
             bool connect ();
             bool disconnect ();
 
@@ -187,7 +200,8 @@ namespace LLPlugin
             bool waitForWrite ();
             bool waitForRead ();
 
-            void listen (msg_id_t id, Message::Listener listen);
+            Connection listen (msg_id_t id, Message::Listener listen);
+            void unlisten (msg_id_t id, Connection c);
 
         public:
             void sendAckPacket ();
@@ -211,6 +225,7 @@ namespace LLPlugin
 
         private:
             void prepare_message_ (Message &m);
+            void recv_pending_ ();
 
             bool send_message_ (Message &m);
             bool send_handle_acking_ (Message &m);
@@ -232,13 +247,14 @@ namespace LLPlugin
 
         private:
             bool    connected_;
+            bool    throttled_;
 
-            MessageFactory          factory_;
+            MessageFactory          &factory_;
             QUdpSocket              udp_;
             QTimer                  timer_;
 
-            Message::NameMap        names_;
-            Message::IDMap          idmap_;
+            const Message::NameMap  &names_;
+            const Message::IDMap    &idmap_;
             Message::SequenceSet    acks_;
             Message::SequenceSet    received_;
             Message::Map            resend_;
@@ -250,6 +266,11 @@ namespace LLPlugin
 
             uint32_t    send_sequence_;
             int         ack_age_;
+
+            uint64_t    sent_count_;
+
+            // polled by task conditions off the main thread
+            Atomic      received_count_;
     };
 
     //=========================================================================
@@ -273,8 +294,14 @@ namespace LLPlugin
             bool connect ();
             bool disconnect ();
 
+            // blocks until the login connects, or msec pass
+            bool waitForConnected (unsigned long msec);
+
         private:
-            bool    connected_;
+            // set by the login on the main thread, and waited on elsewhere
+            Atomic      connected_;
+            Mutex       lock_;
+            Condition   connected_wake_;
 
             Stream  stream_;
             Login   login_;
@@ -305,12 +332,10 @@ namespace LLPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
 
             Connectivity::Session *session();
 
-        protected:
-            void timerEvent (QTimerEvent *e);
-
         private:
             Connectivity::Session *establish_session_blocking_ ();
 
@@ -318,7 +343,6 @@ namespace LLPlugin
             Session session_;
 
             Connectivity::LoginParameters   request_;
-            bool    timeout_;
     };
 }
 #endif
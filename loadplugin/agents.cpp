@@ -0,0 +1,355 @@
+/* agents.cpp -- scripted simulated clients for load generation
+ *
+ *			Ryan McDougall
+ */
+
+#include <QtCore>
+
+#include "stdheaders.hpp"
+#include "application.hpp"
+
+#include "llplugin/provider.hpp"
+#include "loadplugin/agents.hpp"
+
+//=============================================================================
+
+namespace LoadPlugin
+{
+    Step::Script Step::parse (const string &text)
+    {
+        Script script;
+
+        string line;
+        std::istringstream lines (text);
+        while (std::getline (lines, line, ';'))
+        {
+            std::istringstream words (line);
+            string word;
+            if (!(words >> word))
+                continue;
+
+            Step s = { LOGIN, 0 };
+
+            if (word == "login") s.action = LOGIN;
+            else if (word == "start") s.action = START;
+            else if (word == "throttle") s.action = THROTTLE;
+            else if (word == "logout") s.action = LOGOUT;
+            else if (word == "wait" && (words >> s.msec)) s.action = WAIT;
+            else
+            {
+                cerr << "unknown script step: " << line << endl;
+                continue;
+            }
+
+            script.push_back (s);
+        }
+
+        return script;
+    }
+
+    //=========================================================================
+
+    LoadStats::LoadStats () :
+        login_failed_ (0), start_failed_ (0), since_ (Clock::now ())
+    {
+    }
+
+    void LoadStats::login (bool ok, usec_t latency)
+    {
+        Locker mtx (lock_);
+
+        if (ok) login_.record (latency);
+        else ++ login_failed_;
+    }
+
+    void LoadStats::start (bool ok, usec_t latency)
+    {
+        Locker mtx (lock_);
+
+        if (ok) start_.record (latency);
+        else ++ start_failed_;
+    }
+
+    void LoadStats::report (std::ostream &out, int running, uint64_t sent, uint64_t received)
+    {
+        Locker mtx (lock_);
+
+        double seconds = std::max (Clock::now () - since_, (usec_t) 1) / 1e6;
+
+        out << "agents running: " << running << ", up " 
+            << std::fixed << std::setprecision (1) << seconds << "s" << endl;
+
+        out << "  messages: sent " << sent << " (" << sent / seconds << "/s)"
+            << ", received " << received << " (" << received / seconds << "/s)" << endl;
+
+        out << "  login msec: ok " << login_.count() << " failed " << login_failed_
+            << " p50 " << login_.percentile (50) / 1000 
+            << " p99 " << login_.percentile (99) / 1000 
+            << " max " << login_.max() / 1000 << endl;
+
+        out << "  first message msec: ok " << start_.count() << " failed " << start_failed_
+            << " p50 " << start_.percentile (50) / 1000 
+            << " p99 " << start_.percentile (99) / 1000 
+            << " max " << start_.max() / 1000 << endl;
+    }
+
+    //=========================================================================
+
+    Agent::Agent (int id, const Connectivity::LoginParameters &params, 
+            const Step::Script &script, LoadStats *stats) :
+        session_ (new LLPlugin::Session), script_ (script), pc_ (0), stats_ (stats),
+        waiting_ (IDLE), since_ (0), until_ (0), done_ (0), received_ (0), ready_ (0)
+    {
+        QString n (QString::number (id));
+        Connectivity::LoginParameters p (params);
+        p ["first"] = QString (p ["first"]).replace ("%n", n);
+        p ["last"] = QString (p ["last"]).replace ("%n", n);
+
+        session_->setLoginParameters (p);
+    }
+
+    Agent::~Agent ()
+    {
+        session_->disconnect ();
+        delete session_;
+    }
+
+    int Agent::step (frame_delta_t delta)
+    {
+        settle_ ();
+
+        LLPlugin::Stream *stream = session_->stream ();
+        usec_t now = Clock::now ();
+
+        while (pc_ < script_.size())
+        {
+            const Step &s = script_ [pc_++];
+
+            switch (s.action)
+            {
+                case Step::LOGIN:
+                    session_->connect ();
+                    waiting_ = LOGGING_IN;
+                    until_ = now + AGENT_CONNECT_TIMEOUT * 1000;
+                    break;
+
+                case Step::START:
+                    if (!session_->isConnected ())
+                        continue;
+
+                    received_ = stream->received ();
+                    stream->sendUseCircuitCodePacket ();
+                    stream->sendCompleteAgentMovementPacket ();
+                    stream->sendAgentThrottlePacket ();
+                    stream->sendAgentWearablesRequestPacket ();
+
+                    waiting_ = STARTING;
+                    until_ = now + AGENT_CONNECT_TIMEOUT * 1000;
+                    break;
+
+                case Step::WAIT:
+                    waiting_ = WAITING;
+                    until_ = now + (usec_t) s.msec * 1000;
+                    break;
+
+                case Step::THROTTLE:
+                    if (session_->isConnected ())
+                        stream->sendAgentThrottlePacket ();
+                    continue;
+
+                case Step::LOGOUT:
+                    if (session_->isConnected ())
+                        stream->sendLogoutRequest ();
+                    session_->disconnect ();
+                    continue;
+            }
+
+            // park until the step's condition holds
+            since_ = now;
+            done_ = 0;
+            ready_ = 0;
+            return Framework::Task::YIELD;
+        }
+
+        return Framework::Task::SUCCESS;
+    }
+
+    bool Agent::ready (frame_delta_t delta)
+    {
+        if (ready_)
+            return true;
+
+        usec_t now = Clock::now ();
+        bool done = true;
+
+        switch (waiting_)
+        {
+            case LOGGING_IN:
+                done = session_->isConnected () || now >= until_;
+                break;
+
+            case STARTING:
+                done = session_->stream()->received () > received_ || now >= until_;
+                break;
+
+            case WAITING:
+                done = now >= until_;
+                break;
+        }
+
+        // the session and stream publish what is read here atomically, so
+        // this is safe off the main lane too; the first poll to see the
+        // condition hold publishes it, with the time for latencies
+        if (done && ready_.testAndSetOrdered (0, 1))
+            done_ = now;
+
+        return done;
+    }
+
+    uint64_t Agent::sent () const
+    {
+        return session_->stream()->sent ();
+    }
+
+    uint64_t Agent::received () const
+    {
+        return session_->stream()->received ();
+    }
+
+    void Agent::settle_ ()
+    {
+        usec_t latency = (done_? done_ : Clock::now ()) - since_;
+
+        switch (waiting_)
+        {
+            case LOGGING_IN:
+                stats_->login (session_->isConnected (), latency);
+                break;
+
+            case STARTING:
+                stats_->start (session_->stream()->received () > received_, latency);
+                break;
+        }
+
+        waiting_ = IDLE;
+    }
+
+    //=========================================================================
+
+    LoadGenerator::LoadGenerator (int agents, const Connectivity::LoginParameters &params) :
+        scheduler_ (0), params_ (params), count_ (agents), next_report_ (0)
+    {
+        scripts_.push_back ("login; start; wait 30000; logout");
+    }
+
+    LoadGenerator::~LoadGenerator ()
+    {
+        for_each (agents_.begin(), agents_.end(), safe_delete <Agent>);
+    }
+
+    void LoadGenerator::setScripts (const std::vector <string> &scripts)
+    {
+        if (scripts.size())
+            scripts_ = scripts;
+    }
+
+    void LoadGenerator::setReportPath (const string &path)
+    {
+        report_path_ = path;
+    }
+
+    void LoadGenerator::initialize (Framework::Scheduler *s)
+    {
+        using Framework::Task;
+
+        scheduler_ = s;
+
+        cout << "load generator starting " << count_ << " agents" << endl;
+
+        std::vector <Step::Script> scripts;
+        std::transform (scripts_.begin(), scripts_.end(), 
+                std::back_inserter (scripts), &Step::parse);
+
+        // agents drive Qt sockets, so they all live on the main lane
+        Task::List tasks;
+        for (int i = 0; i < count_; ++i)
+        {
+            Agent *agent = new Agent (i, params_, scripts [i % scripts.size()], &stats_);
+            agents_.push_back (agent);
+
+            Task *task = new Task (bind (&LoadGenerator::do_agent, this, agent, _1), 
+                    Task::NORMAL, Task::MAIN_LANE);
+            tasks.push_back (task->wait (bind (&Agent::ready, agent, _1))->named ("agent"));
+        }
+
+        running_ = count_;
+        next_report_ = Clock::now () + LOAD_REPORT_INTERVAL * 1000;
+
+        Task *report = new Task (bind (&LoadGenerator::do_report, this, _1), 
+                Task::LOW, Task::MAIN_LANE);
+        tasks.push_back (report->wait (bind (&LoadGenerator::is_report_due, this, _1)));
+
+        scheduler_->enqueue (tasks);
+    }
+
+    void LoadGenerator::finalize ()
+    {
+    }
+
+    int LoadGenerator::affinity () const
+    {
+        // builds sessions, which own Qt sockets
+        return Framework::Task::MAIN_LANE;
+    }
+
+    int LoadGenerator::do_agent (Agent *agent, frame_delta_t delta)
+    {
+        int result = agent->step (delta);
+
+        if (result != Framework::Task::YIELD)
+            running_.deref ();
+
+        return result;
+    }
+
+    bool LoadGenerator::is_report_due (frame_delta_t delta)
+    {
+        return running_ == 0 || Clock::now () >= next_report_;
+    }
+
+    int LoadGenerator::do_report (frame_delta_t delta)
+    {
+        do_report_write (cout);
+
+        if (running_ > 0)
+        {
+            next_report_ += LOAD_REPORT_INTERVAL * 1000;
+            return Framework::Task::YIELD;
+        }
+
+        if (!report_path_.empty())
+        {
+            std::ofstream out (report_path_.c_str());
+            do_report_write (out);
+        }
+
+        QCoreApplication::exit ();
+
+        return Framework::Task::SUCCESS;
+    }
+
+    void LoadGenerator::do_report_write (std::ostream &out)
+    {
+        uint64_t sent = 0, received = 0;
+
+        std::vector <Agent *>::const_iterator i = agents_.begin();
+        std::vector <Agent *>::const_iterator e = agents_.end();
+        for (; i != e; ++i)
+        {
+            sent += (*i)->sent ();
+            received += (*i)->received ();
+        }
+
+        stats_.report (out, running_, sent, received);
+    }
+}
@@ -0,0 +1,146 @@
+/* agents.hpp -- scripted simulated clients for load generation
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef AGENTS_H_
+#define AGENTS_H_
+
+#include "application.hpp"
+#include "session.hpp"
+
+namespace LLPlugin
+{
+    class Session;
+}
+
+namespace LoadPlugin
+{
+    using namespace Scaffold;
+
+    // give up on a login or a first message after this long (msec)
+    const int AGENT_CONNECT_TIMEOUT (30000);
+
+    // aggregate report period (msec)
+    const int LOAD_REPORT_INTERVAL (5000);
+
+    // scripts are ';' or newline separated steps, e.g.
+    //   login; start; wait 10000; throttle; wait 5000; logout
+    struct Step
+    {
+        typedef std::vector <Step> Script;
+
+        enum
+        {
+            LOGIN,
+            START,
+            WAIT,
+            THROTTLE,
+            LOGOUT
+        };
+
+        int action;
+        int msec;
+
+        static Script parse (const string &text);
+    };
+
+    // counters and latencies shared by all agents
+    class LoadStats
+    {
+        public:
+            LoadStats ();
+
+            void login (bool ok, usec_t latency);
+            void start (bool ok, usec_t latency);
+
+            void report (std::ostream &out, int running, uint64_t sent, uint64_t received);
+
+        private:
+            Framework::Histogram    login_;
+            Framework::Histogram    start_;
+
+            int         login_failed_;
+            int         start_failed_;
+            usec_t      since_;
+            Mutex       lock_;
+    };
+
+    // one simulated client; runs its script as a resumable main-lane task
+    class Agent
+    {
+        public:
+            Agent (int id, const Connectivity::LoginParameters &params, 
+                    const Step::Script &script, LoadStats *stats);
+            ~Agent ();
+
+            int step (frame_delta_t delta);
+            bool ready (frame_delta_t delta);
+
+            uint64_t sent () const;
+            uint64_t received () const;
+
+        private:
+            enum
+            {
+                IDLE,
+                LOGGING_IN,
+                STARTING,
+                WAITING
+            };
+
+            void settle_ ();
+
+        private:
+            LLPlugin::Session   *session_;
+            Step::Script        script_;
+            size_t              pc_;
+            LoadStats           *stats_;
+
+            int                 waiting_;
+            usec_t              since_;
+            usec_t              until_;
+            usec_t              done_;
+            uint64_t            received_;
+
+            // raised by whichever poll first sees the step's condition hold
+            Atomic              ready_;
+    };
+
+    // runs N agents in this process on the application's scheduler; 
+    // "%n" in the first or last name is replaced with the agent number
+    class LoadGenerator : public Framework::Module
+    {
+        public:
+            LoadGenerator (int agents, const Connectivity::LoginParameters &params);
+            ~LoadGenerator ();
+
+            // agent i runs scripts [i % size]
+            void setScripts (const std::vector <string> &scripts);
+            void setReportPath (const string &path);
+
+            void initialize (Framework::Scheduler *s);
+            void finalize ();
+            int affinity () const;
+
+        private:
+            int do_agent (Agent *agent, frame_delta_t delta);
+            int do_report (frame_delta_t delta);
+            bool is_report_due (frame_delta_t delta);
+            void do_report_write (std::ostream &out);
+
+        private:
+            Framework::Scheduler    *scheduler_;
+            std::vector <Agent *>   agents_;
+            std::vector <string>    scripts_;
+            LoadStats               stats_;
+
+            Connectivity::LoginParameters params_;
+            int                     count_;
+            Atomic                  running_;
+            usec_t                  next_report_;
+            string                  report_path_;
+    };
+}
+
+#endif
@@ -10,6 +10,7 @@
 #include "llplugin/provider.hpp"
 #include "uiplugin/provider.hpp"
 #include "viewerplugin/logic.hpp"
+#include "loadplugin/agents.hpp"
 
 //=============================================================================
 // Framework Globals
@@ -24,12 +25,90 @@ Scaffold::View::KeyBindingManager       *service_keybinding_manager;
 Scaffold::View::SettingsManager         *service_settings_manager;
 Scaffold::View::ViewManager             *service_view_manager;
 
+//=============================================================================
+// Command line helpers
+
+static bool has_flag (int argc, char **argv, const char *flag)
+{
+    for (int i = 1; i < argc; ++i)
+        if (!strcmp (argv [i], flag))
+            return true;
+
+    return false;
+}
+
+static QString flag_value (const QStringList &args, const char *flag)
+{
+    int i = args.indexOf (flag);
+    return (i >= 0 && i + 1 < args.size())? args [i + 1] : QString ();
+}
+
+// for flags whose value may be left out: the next argument, unless it 
+// is another flag
+static QString optional_value (const QStringList &args, const char *flag)
+{
+    QString value = flag_value (args, flag);
+    return value.startsWith ("-")? QString () : value;
+}
+
+// login comes from --config file, then --user "First Last", --password 
+// and --host, each overriding the file
+static Scaffold::Connectivity::LoginParameters login_params (const QStringList &args)
+{
+    Scaffold::Connectivity::LoginParameters params;
+
+    QString config = flag_value (args, "--config");
+    if (!config.isEmpty())
+        params = ViewerPlugin::Logic::readLoginConfig (config);
+
+    QStringList names = flag_value (args, "--user").split (" ");
+    if (names.count() == 2)
+    {
+        params ["first"] = names.at(0);
+        params ["last"] = names.at(1);
+    }
+
+    if (args.contains ("--password"))
+        params ["pass"] = flag_value (args, "--password");
+
+    if (args.contains ("--host"))
+        params ["service"] = flag_value (args, "--host");
+
+    return params;
+}
+
+// --script "steps" for every agent, or --script-file with one per line
+static std::vector <string> agent_scripts (const QStringList &args)
+{
+    std::vector <string> scripts;
+
+    if (args.contains ("--script"))
+        scripts.push_back (flag_value (args, "--script").toStdString ());
+
+    QString path = flag_value (args, "--script-file");
+    if (!path.isEmpty())
+    {
+        string line;
+        std::ifstream file (path.toStdString ().c_str());
+        while (std::getline (file, line))
+            if (!line.empty())
+                scripts.push_back (line);
+    }
+
+    return scripts;
+}
+
 //=============================================================================
 // Main entry point
 int main (int argc, char** argv)
 {
     using namespace Scaffold;
 
+    // --headless runs without a display: no widgets and no UI providers;
+    // --agents n generates load from n scripted clients, also headless
+    bool load = has_flag (argc, argv, "--agents");
+    bool headless = load || has_flag (argc, argv, "--headless");
+
     // entities
     model_entities = new Model::Scene;
     model_entity_factory = new Model::EntityFactory;
@@ -42,8 +121,27 @@ int main (int argc, char** argv)
     service_settings_manager = new View::SettingsManager;
     service_view_manager = new View::ViewManager;
 
-    // application
-    Application app (argc, argv);
+    // application, with one scheduler worker per core
+    Application app (argc, argv, QThread::idealThreadCount (), !headless);
+
+    // --fps n runs the simulation on n fixed ticks per second; without it
+    // frames run back to back
+    QStringList args (app.arguments ());
+    int fps = args.indexOf ("--fps");
+    if (fps >= 0 && fps + 1 < args.size())
+        app.setFrameRate (args [fps + 1].toInt ());
+
+    // --parallel-pump spreads per-frame worker updates over the scheduler
+    if (args.contains ("--parallel-pump"))
+        app.setParallelPump (true);
+
+    // --profile [file] times each phase of the frame
+    if (args.contains ("--profile"))
+        app.setProfiling (optional_value (args, "--profile").toStdString ());
+
+    // --trace [file] captures per-task timings for the session
+    if (args.contains ("--trace"))
+        app.setTracing (optional_value (args, "--trace").toStdString ());
 
     app.attach (service_session_manager);
     app.attach (service_notification_manager);
@@ -53,7 +151,25 @@ int main (int argc, char** argv)
     app.attach (service_view_manager);
 
     // modules
-    app.attach (new ViewerPlugin::Logic);
+    if (load)
+    {
+        LoadPlugin::LoadGenerator *generator = new LoadPlugin::LoadGenerator 
+            (flag_value (args, "--agents").toInt (), login_params (args));
+
+        generator->setScripts (agent_scripts (args));
+        generator->setReportPath (flag_value (args, "--report").toStdString ());
+
+        app.attach (generator);
+    }
+    else
+    {
+        ViewerPlugin::Logic *logic = new ViewerPlugin::Logic;
+
+        if (headless)
+            logic->setHeadless (login_params (args));
+
+        app.attach (logic);
+    }
 
     return app.exec ();
 }
@@ -18,6 +18,24 @@ namespace Scaffold
                 virtual ~Module () {}
                 virtual void initialize (Scheduler *) = 0;
                 virtual void finalize () = 0;
+
+                // lane initialize () runs on at start-up; modules with no 
+                // dependency between them may initialize concurrently, so
+                // each must say whether it needs the main thread
+                virtual int affinity () const = 0;
+
+                // initialize only once m has; dependencies must not form a cycle
+                void after (Module *m) { dependencies_.push_back (m); }
+                const List &dependencies () const { return dependencies_; }
+
+                static int initialize_task (Module *m, Scheduler *s, frame_delta_t)
+                {
+                    m->initialize (s);
+                    return Task::SUCCESS;
+                }
+
+            private:
+                List    dependencies_;
         };
 
         class Plugin
@@ -29,6 +47,18 @@ namespace Scaffold
                 virtual void initialize () = 0;
                 virtual void finalize () = 0;
                 virtual void update () = 0;
+
+                // lane initialize () and update () run on; anything touching
+                // Qt objects must stay on the main thread. Providers on any 
+                // other lane are initialized on first use, by whichever 
+                // thread that is
+                virtual int affinity () const = 0;
+
+                static int update_task (Plugin *p, frame_delta_t)
+                {
+                    p->update ();
+                    return Task::SUCCESS;
+                }
         };
 
         class Worker
@@ -38,6 +68,28 @@ namespace Scaffold
 
                 virtual ~Worker () {}
                 virtual void pump () = 0;
+
+                // split one pump into tasks that may run concurrently; by 
+                // default a single main-lane task that calls pump ()
+                virtual void pumpTasks (Task::List &list)
+                {
+                    list.push_back (new Task (bind (&Worker::pump_task, this, _1), 
+                                Task::HIGH, Task::MAIN_LANE));
+                }
+
+                // when pumped in parallel, start only once w has finished; 
+                // dependencies must not form a cycle
+                void after (Worker *w) { dependencies_.push_back (w); }
+                const List &dependencies () const { return dependencies_; }
+
+                static int pump_task (Worker *w, frame_delta_t)
+                {
+                    w->pump ();
+                    return Task::SUCCESS;
+                }
+
+            private:
+                List    dependencies_;
         };
     }
 }
@@ -0,0 +1,129 @@
+/* parallel.cpp -- data-parallel loops over the task scheduler
+ *
+ *			Ryan McDougall
+ */
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
+#include "task.hpp"
+#include "parallel.hpp"
+
+//=============================================================================
+//
+namespace Scaffold
+{
+    namespace Framework
+    {
+        // shared by the caller and its helper tasks; helpers may outlive
+        // the call, so it is reference counted rather than on the stack
+        class ParallelRange
+        {
+            public:
+                typedef shared_ptr <ParallelRange> Ptr;
+
+                ParallelRange (const RangeBody &body, size_t begin, size_t end, size_t grain) :
+                    body_ (body), begin_ (begin), end_ (end), grain_ (grain),
+                    chunks_ ((end - begin + grain - 1) / grain), next_ (0), done_ (0)
+                {}
+
+                int chunks () const
+                {
+                    return chunks_;
+                }
+
+                // claim and run chunks until none remain
+                void help ()
+                {
+                    while (run_chunk_ ());
+                }
+
+                // only the caller may join; returns when every chunk has run
+                void join ()
+                {
+                    Locker mtx (lock_);
+                    while (done_ < chunks_)
+                        finished_.wait (&lock_);
+                }
+
+                static int run (Ptr range, frame_delta_t)
+                {
+                    range->help ();
+                    return Task::SUCCESS;
+                }
+
+            private:
+                bool run_chunk_ ()
+                {
+                    int chunk = next_.fetchAndAddRelaxed (1);
+                    if (chunk >= chunks_)
+                        return false;
+
+                    size_t b = begin_ + chunk * grain_;
+                    size_t e = std::min (b + grain_, end_);
+                    body_ (b, e);
+
+                    if (done_.fetchAndAddOrdered (1) + 1 == chunks_)
+                    {
+                        Locker mtx (lock_);
+                        finished_.wakeAll ();
+                    }
+
+                    return true;
+                }
+
+            private:
+                RangeBody   body_;
+                size_t      begin_;
+                size_t      end_;
+                size_t      grain_;
+                int         chunks_;
+
+                Atomic      next_;
+                Atomic      done_;
+                Mutex       lock_;
+                Condition   finished_;
+        };
+
+        size_t parallel_grain (Scheduler &scheduler, size_t begin, size_t end, size_t grain)
+        {
+            if (grain > 0)
+                return grain;
+
+            size_t threads = scheduler.workers () + 1;
+            size_t chunks = threads * PARALLEL_CHUNKS_PER_THREAD;
+
+            return std::max ((end - begin + chunks - 1) / chunks, (size_t) 1);
+        }
+
+        void parallel_for (Scheduler &scheduler, size_t begin, size_t end, 
+                const RangeBody &body, size_t grain)
+        {
+            if (end <= begin)
+                return;
+
+            grain = parallel_grain (scheduler, begin, end, grain);
+
+            // a single chunk isn't worth a round trip through the scheduler
+            if (end - begin <= grain)
+            {
+                body (begin, end);
+                return;
+            }
+
+            ParallelRange::Ptr range (new ParallelRange (body, begin, end, grain));
+
+            // the caller is one of the helpers, so at most chunks - 1 more
+            int helpers = std::min (range->chunks () - 1, scheduler.workers ());
+
+            // helpers are optional, so never block on a full queue for them
+            for (int i = 0; i < helpers; ++i)
+                if (!scheduler.tryEnqueue (new Task (bind (&ParallelRange::run, range, _1), Task::HIGH)))
+                    break;
+
+            range->help ();
+            range->join ();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/* parallel.hpp -- data-parallel loops over the task scheduler
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+namespace Scaffold
+{
+    namespace Framework
+    {
+        // with no grain given, aim for this many chunks per thread, so 
+        // uneven chunks still balance out
+        const size_t PARALLEL_CHUNKS_PER_THREAD (4);
+
+        typedef function <void (size_t, size_t)> RangeBody;
+
+        // grain actually used for [begin, end) when grain is 0
+        size_t parallel_grain (Scheduler &scheduler, size_t begin, size_t end, size_t grain = 0);
+
+        // run body over [begin, end) in chunks of at most grain items, on the 
+        // scheduler's workers and the calling thread; returns once all chunks
+        // have run. The caller takes chunks too, so this is safe from a task.
+        void parallel_for (Scheduler &scheduler, size_t begin, size_t end, 
+                const RangeBody &body, size_t grain = 0);
+
+        template <typename T, typename Map>
+        struct ReduceChunk
+        {
+            std::vector <T> *partials;
+            Map             map;
+            size_t          begin;
+            size_t          grain;
+
+            void operator() (size_t b, size_t e) 
+            { 
+                (*partials) [(b - begin) / grain] = map (b, e); 
+            }
+        };
+
+        // map each chunk to a T, then fold the partials in range order, so 
+        // the result is deterministic for any associative combine
+        template <typename T, typename Map, typename Combine>
+        T parallel_reduce (Scheduler &scheduler, size_t begin, size_t end, 
+                T identity, Map map, Combine combine, size_t grain = 0)
+        {
+            if (end <= begin)
+                return identity;
+
+            grain = parallel_grain (scheduler, begin, end, grain);
+
+            std::vector <T> partials ((end - begin + grain - 1) / grain, identity);
+            ReduceChunk <T, Map> chunk = { &partials, map, begin, grain };
+            parallel_for (scheduler, begin, end, chunk, grain);
+
+            T result (identity);
+            typename std::vector <T>::const_iterator i = partials.begin();
+            typename std::vector <T>::const_iterator e = partials.end();
+            for (; i != e; ++i) result = combine (result, *i);
+
+            return result;
+        }
+    }
+}
+
+#endif //PARALLEL_H_
@@ -40,6 +40,10 @@ namespace Scaffold
         };
 
         // Manager for multiple providers for a single service
+        // providers are initialized lazily, on the first retire or get that
+        // reaches them, and aren't updated until then; the exception is
+        // main lane providers, which start as they are attached, since a
+        // first use may come from a worker
 
         template <typename Request, typename Response>
         class Manager : public Framework::Worker
@@ -57,24 +61,52 @@ namespace Scaffold
 
                     for (; i != e; ++i) 
                     {
-                        (*i)->finalize ();
+                        if (started_.count (*i))
+                            (*i)->finalize ();
+
                         delete *i;
                     }
                 }
 
+                // call from the main thread
                 virtual void attach (ProviderType *provider)
                 {
-                    provider->initialize ();
                     providers_.push_back (provider);
+
+                    if (provider->affinity () == Framework::Task::MAIN_LANE)
+                        start_ (provider);
+                }
+
+                // initialize every provider now, rather than on first use
+                void start ()
+                {
+                    for_each (providers_.begin(), providers_.end(), 
+                            bind (&Manager::start_, this, _1));
                 }
 
                 virtual void pump ()
                 {
+                    Framework::ProfileScope scope (framework_profiler, "service-pump");
+
                     typename ProviderType::List::const_iterator i = providers_.begin();
                     typename ProviderType::List::const_iterator e = providers_.end();
 
                     for (; i != e; ++i) 
-                        (*i)->update ();
+                        if (is_started_ (*i))
+                            (*i)->update ();
+                }
+
+                // providers are independent, so each gets a task on its lane
+                virtual void pumpTasks (Framework::Task::List &list)
+                {
+                    typename ProviderType::List::const_iterator i = providers_.begin();
+                    typename ProviderType::List::const_iterator e = providers_.end();
+
+                    for (; i != e; ++i) 
+                        if (is_started_ (*i))
+                            list.push_back (new Framework::Task 
+                                    (bind (&Framework::Plugin::update_task, *i, _1), 
+                                     Framework::Task::HIGH, (*i)->affinity ()));
                 }
 
                 virtual ProviderType *get (const Tag &t) const
@@ -84,7 +116,7 @@ namespace Scaffold
 
                     for (; i != e; ++i) 
                         if ((*i)->tag() == t) 
-                            return *i;
+                            return start_ (*i);
                 }
 
                 virtual ResponseType retire (RequestType r)
@@ -94,13 +126,33 @@ namespace Scaffold
 
                     for (; i != e; ++i) 
                         if ((*i)->accepts (r))
-                            return (*i)->retire (r);
+                            return start_ (*i)->retire (r);
 
                     return ResponseType ();
                 }
 
+            private:
+                ProviderType *start_ (ProviderType *provider) const
+                {
+                    Locker mtx (start_lock_);
+
+                    if (started_.insert (provider).second)
+                        provider->initialize ();
+
+                    return provider;
+                }
+
+                bool is_started_ (ProviderType *provider) const
+                {
+                    Locker mtx (start_lock_);
+                    return started_.count (provider);
+                }
+
             private:
                 typename ProviderType::List providers_;
+
+                mutable std::set <ProviderType *>   started_;
+                mutable Mutex                       start_lock_;
         };
     }
 }
@@ -13,14 +13,18 @@
 #include <ios>
 #include <iomanip>
 #include <iostream>
+#include <climits>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <set>
 #include <map>
 #include <list>
+#include <deque>
 #include <vector>
 #include <memory>
+#include <new>
 #include <algorithm>
 #include <iterator>
 
@@ -31,6 +35,9 @@
     
 #include <QString>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QWaitCondition>
 
 using std::isnan;
 using std::isfinite;
@@ -53,6 +60,8 @@ using namespace std::tr1::placeholders;
 typedef uint32_t msg_id_t;
 typedef int frame_delta_t;
 typedef QMutex Mutex;
+typedef QAtomicInt Atomic;
+typedef QWaitCondition Condition;
 
 template <typename T, bool fundamental> struct rvalue_helper {};
 template <typename T> struct rvalue_helper <T, true> { typedef T type; };
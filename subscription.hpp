@@ -8,18 +8,169 @@
 
 namespace Scaffold
 {
+    // handle to one subscriber, for disconnecting it later; a default
+    // constructed connection refers to nothing
+    struct Connection
+    {
+        Connection () : index (0), serial (0) {}
+        Connection (size_t i, size_t s) : index (i), serial (s) {}
+
+        size_t  index;
+        size_t  serial;
+    };
+
+    // subscribers are delegates, so small binds are held in place and a 
+    // publish makes one indirect call per subscriber
+    //
+    // subscribers may connect and disconnect from inside a publish: new 
+    // ones are held aside and first called on the next publish, and 
+    // disconnected ones are skipped at once but only removed after the 
+    // outermost publish returns. Slots are compacted once half are dead,
+    // so publish cost follows the live subscriber count.
+    //
+    // a publish with no subscribers touches nothing, and one that changes
+    // nothing pays for a counter and one test; the bookkeeping runs only 
+    // after a pass that connected or disconnected something.
     template <typename F>
         struct SubscriptionBase
         {
-            typedef function <F> Function;
-            typedef std::vector <Function> List;
+            public:
+                typedef Delegate <F> Function;
 
-            void operator+= (Function subscriber)
-            {
-                subscribers.push_back (subscriber);
-            }
+                struct Slot
+                {
+                    Slot (const Function &f, size_t s) : call (f), serial (s), live (true) {}
+
+                    Function    call;
+                    size_t      serial;
+                    bool        live;
+                };
+
+                typedef std::vector <Slot> List;
+
+                SubscriptionBase () : serial_ (0), dead_ (0), dispatching_ (0), pending_ (false) {}
+
+                Connection operator+= (Function subscriber)
+                {
+                    return connect (subscriber);
+                }
+
+                Connection connect (Function subscriber)
+                {
+                    Connection c (slots_.size() + added_.size(), ++ serial_);
+
+                    if (dispatching_)
+                    {
+                        added_.push_back (Slot (subscriber, c.serial));
+                        pending_ = true;
+                    }
+                    else
+                        slots_.push_back (Slot (subscriber, c.serial));
+
+                    return c;
+                }
+
+                // a member function subscriber, called without a bind object
+                template <typename C, typename M>
+                    Connection subscribe (C *object, M method)
+                    {
+                        return connect (Function (object, method));
+                    }
+
+                // O(1) unless compaction has moved the slot since it connected;
+                // false if it was already disconnected
+                bool disconnect (Connection c)
+                {
+                    Slot *slot = find_ (slots_, c.index, c.serial);
+
+                    if (!slot)
+                        slot = find_ (added_, (c.index >= slots_.size())? 
+                                c.index - slots_.size() : added_.size(), c.serial);
+
+                    if (!slot || !slot->live)
+                        return false;
+
+                    slot->live = false;
+                    ++ dead_;
+
+                    if (dispatching_)
+                        pending_ = true;
+                    else
+                        tidy_ ();
+
+                    return true;
+                }
+
+                size_t size () const
+                {
+                    return slots_.size() + added_.size() - dead_;
+                }
+
+            protected:
+                // bracket one publish. Nothing moves the slots until the 
+                // outermost one leaves, so the pass can walk them directly
+                const Slot *enter_ () const
+                {
+                    ++ dispatching_;
+                    return &slots_ [0];
+                }
+
+                void leave_ () const
+                {
+                    if (!-- dispatching_ && pending_)
+                        tidy_ ();
+                }
 
-            List subscribers;
+                // slots stay in serial order, and compaction only moves 
+                // them down, so a stale index still bounds the search
+                static Slot *find_ (List &list, size_t hint, size_t serial)
+                {
+                    if (hint < list.size() && list [hint].serial == serial)
+                        return &list [hint];
+
+                    size_t lo = 0, hi = (hint < list.size())? hint + 1 : list.size();
+                    while (lo < hi)
+                    {
+                        size_t mid = (lo + hi) / 2;
+                        if (list [mid].serial < serial) lo = mid + 1;
+                        else hi = mid;
+                    }
+
+                    return (lo < list.size() && list [lo].serial == serial)? &list [lo] : 0;
+                }
+
+                void tidy_ () const
+                {
+                    pending_ = false;
+
+                    if (!added_.empty())
+                    {
+                        slots_.insert (slots_.end(), added_.begin(), added_.end());
+                        added_.clear ();
+                    }
+
+                    if (!dead_ || dead_ * 2 < slots_.size())
+                        return;
+
+                    size_t n = 0;
+                    for (size_t i = 0; i < slots_.size(); ++i)
+                        if (slots_ [i].live)
+                        {
+                            if (n != i) slots_ [n] = slots_ [i];
+                            ++ n;
+                        }
+
+                    slots_.erase (slots_.begin() + n, slots_.end());
+                    dead_ = 0;
+                }
+
+            protected:
+                mutable List    slots_;
+                mutable List    added_;
+                size_t          serial_;
+                mutable size_t  dead_;
+                mutable int     dispatching_;
+                mutable bool    pending_;
         };
 
     template <typename F>
@@ -32,9 +183,17 @@ namespace Scaffold
 
             void operator() (T arg) const
             {
-                typename BaseType::List::const_iterator i = BaseType::subscribers.begin();
-                typename BaseType::List::const_iterator e = BaseType::subscribers.end();
-                for (; i != e; ++i) (*i) (arg);
+                if (BaseType::slots_.empty())
+                    return;
+
+                const typename BaseType::Slot *i = BaseType::enter_ ();
+                const typename BaseType::Slot *e = i + BaseType::slots_.size();
+
+                for (; i != e; ++i) 
+                    if (i->live) 
+                        i->call (arg);
+
+                BaseType::leave_ ();
             }
         };
 
@@ -45,9 +204,17 @@ namespace Scaffold
 
             void operator() (T arg) const
             {
-                typename BaseType::List::const_iterator i = BaseType::subscribers.begin();
-                typename BaseType::List::const_iterator e = BaseType::subscribers.end();
-                for (; i != e; ++i) if ((*i) (arg)) break;
+                if (BaseType::slots_.empty())
+                    return;
+
+                const typename BaseType::Slot *i = BaseType::enter_ ();
+                const typename BaseType::Slot *e = i + BaseType::slots_.size();
+
+                for (; i != e; ++i) 
+                    if (i->live && i->call (arg)) 
+                        break;
+
+                BaseType::leave_ ();
             }
         };
 
@@ -58,9 +225,17 @@ namespace Scaffold
 
             void operator() (T1 arg1, T2 arg2) const
             {
-                typename BaseType::List::const_iterator i = BaseType::subscribers.begin();
-                typename BaseType::List::const_iterator e = BaseType::subscribers.end();
-                for (; i != e; ++i) (*i) (arg1, arg2);
+                if (BaseType::slots_.empty())
+                    return;
+
+                const typename BaseType::Slot *i = BaseType::enter_ ();
+                const typename BaseType::Slot *e = i + BaseType::slots_.size();
+
+                for (; i != e; ++i) 
+                    if (i->live) 
+                        i->call (arg1, arg2);
+
+                BaseType::leave_ ();
             }
         };
 
@@ -71,9 +246,17 @@ namespace Scaffold
 
             void operator() (T1 arg1, T2 arg2) const
             {
-                typename BaseType::List::const_iterator i = BaseType::subscribers.begin();
-                typename BaseType::List::const_iterator e = BaseType::subscribers.end();
-                for (; i != e; ++i) if ((*i) (arg1, arg2)) break;
+                if (BaseType::slots_.empty())
+                    return;
+
+                const typename BaseType::Slot *i = BaseType::enter_ ();
+                const typename BaseType::Slot *e = i + BaseType::slots_.size();
+
+                for (; i != e; ++i) 
+                    if (i->live && i->call (arg1, arg2)) 
+                        break;
+
+                BaseType::leave_ ();
             }
         };
 }
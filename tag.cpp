@@ -1,4 +1,4 @@
-/* tag.cpp -- identifies class by string name or 4-byte integer
+/* tag.cpp -- identifies class by string name or 8-byte integer
  *
  *			Ryan McDougall
  */
@@ -22,7 +22,7 @@
 // 2. It will not produce the same results on little-endian and big-endian
 //    machines.
 
-static unsigned int simple_hash (const void *key, int len, unsigned int seed)
+unsigned int Scaffold::murmur_hash2 (const void *key, int len, unsigned int seed)
 {
 	// 'm' and 'r' are mixing constants generated offline.
 	// They're not really 'magic', they just happen to work well.
@@ -57,8 +57,8 @@ static unsigned int simple_hash (const void *key, int len, unsigned int seed)
 
 	switch(len)
 	{
-	case 3: h ^= data[2] << 16;
-	case 2: h ^= data[1] << 8;
+	case 3: h ^= data[2] << 16; // fall through
+	case 2: h ^= data[1] << 8; // fall through
 	case 1: h ^= data[0];
 	        h *= m;
 	};
@@ -73,21 +73,226 @@ static unsigned int simple_hash (const void *key, int len, unsigned int seed)
 	return h;
 } 
 
+//-----------------------------------------------------------------------------
+// wyhash (final 4.2), by Wang Yi; public domain
+
+// reads are done through memcpy, so keys need no particular alignment;
+// like MurmurHash2, results differ between little- and big-endian machines
+
+static const uint64_t wy_secret [4] = 
+{ 
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL 
+};
+
+static inline uint64_t wy_read8 (const uint8_t *p)
+{
+    uint64_t v; 
+    memcpy (&v, p, 8); 
+    return v;
+}
+
+static inline uint64_t wy_read4 (const uint8_t *p)
+{
+    uint32_t v; 
+    memcpy (&v, p, 4); 
+    return v;
+}
+
+static inline uint64_t wy_read3 (const uint8_t *p, size_t k)
+{
+    return (((uint64_t) p[0]) << 16) | (((uint64_t) p[k >> 1]) << 8) | p[k - 1];
+}
+
+// 64x64 -> 128 bit multiply; low half to a, high half to b
+static inline void wy_mum (uint64_t &a, uint64_t &b)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = a;
+    r *= b; 
+    a = (uint64_t) r; 
+    b = (uint64_t) (r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32); 
+    c += lo < t;
+    a = lo; 
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wy_mix (uint64_t a, uint64_t b)
+{
+    wy_mum (a, b); 
+    return a ^ b;
+}
+
+uint64_t Scaffold::wy_hash (const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *) key; 
+    const uint64_t *secret = wy_secret;
+    uint64_t a, b;
+
+    seed ^= wy_mix (seed ^ secret[0], secret[1]); 
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        { 
+            a = (wy_read4 (p) << 32) | wy_read4 (p + ((len >> 3) << 2)); 
+            b = (wy_read4 (p + len - 4) << 32) | wy_read4 (p + len - 4 - ((len >> 3) << 2)); 
+        }
+        else if (len > 0)
+        { 
+            a = wy_read3 (p, len); 
+            b = 0;
+        }
+        else 
+            a = b = 0;
+    }
+    else
+    {
+        size_t i = len;
+
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+
+            do
+            {
+                seed = wy_mix (wy_read8 (p) ^ secret[1], wy_read8 (p + 8) ^ seed);
+                see1 = wy_mix (wy_read8 (p + 16) ^ secret[2], wy_read8 (p + 24) ^ see1);
+                see2 = wy_mix (wy_read8 (p + 32) ^ secret[3], wy_read8 (p + 40) ^ see2);
+                p += 48; 
+                i -= 48;
+            }
+            while (i > 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {  
+            seed = wy_mix (wy_read8 (p) ^ secret[1], wy_read8 (p + 8) ^ seed);  
+            i -= 16; 
+            p += 16;  
+        }
+
+        a = wy_read8 (p + i - 16);  
+        b = wy_read8 (p + i - 8);
+    }
+
+    a ^= secret[1]; 
+    b ^= seed;  
+    wy_mum (a, b);
+
+    return wy_mix (a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+// the hash tags are numbered by
+#ifdef TAG_HASH32
+static inline Scaffold::tag_t simple_hash (const void *key, size_t len, unsigned int seed)
+{
+    return Scaffold::murmur_hash2 (key, len, seed);
+}
+#else
+static inline Scaffold::tag_t simple_hash (const void *key, size_t len, unsigned int seed)
+{
+    return Scaffold::wy_hash (key, len, seed);
+}
+#endif
+
 namespace Scaffold
 {
+    //-------------------------------------------------------------------------
+    // intern table; entries are never removed, so names outlive every tag.
+    // lookups of names already interned read the chains without locking;
+    // only adding a name takes the lock, and publishes it with one store
+
+    const size_t INTERN_BUCKETS (1024);
+
+    struct InternEntry
+    {
+        InternEntry (tag_t t, const char *n, size_t len, InternEntry *x) :
+            number (t), name (n, len), next (x) {}
+
+        tag_t           number;
+        const string    name;
+        InternEntry     *next;
+    };
+
+    typedef QAtomicPointer <InternEntry> InternBucket;
+
+    static Mutex &intern_lock ()
+    {
+        static Mutex lock;
+        return lock;
+    }
+
+    static InternBucket &intern_bucket (tag_t number)
+    {
+        static InternBucket table [INTERN_BUCKETS];
+        return table [number % INTERN_BUCKETS];
+    }
+
+    static InternEntry *intern_find (InternEntry *e, tag_t number, const char *n, size_t len)
+    {
+        for (; e; e = e->next)
+            if (e->number == number && e->name.compare (0, string::npos, n, len) == 0)
+                return e;
+
+        return 0;
+    }
+
+    static const string *intern (tag_t number, const char *n, size_t len)
+    {
+        InternBucket &bucket = intern_bucket (number);
+
+        InternEntry *found = intern_find (bucket, number, n, len);
+        if (found) return &found->name;
+
+        Locker mtx (intern_lock ());
+
+        // someone may have added it since we looked
+        InternEntry *head = bucket;
+        found = intern_find (head, number, n, len);
+        if (found) return &found->name;
+
+#ifndef NDEBUG
+        for (InternEntry *e = head; e; e = e->next)
+            if (e->number == number)
+            {
+                cerr << "tag collision: \"" << string (n, len) << "\" and \"" 
+                    << e->name << "\" both hash to " << number << endl;
+                assert (e->number != number);
+            }
+#endif
+
+        InternEntry *entry = new InternEntry (number, n, len, head);
+        bucket.fetchAndStoreOrdered (entry);
+
+        return &entry->name;
+    }
+
+    //-------------------------------------------------------------------------
+
     Tag::Tag () 
-        : number (0) 
+        : name (intern (0, "", 0)), number (0) 
     {
     }
 
     Tag::Tag (const string &n, unsigned int seed)
-        : name (n), number (simple_hash (n.c_str(), n.size(), seed)) 
+        : number (simple_hash (n.c_str(), n.size(), seed)) 
     {
+        name = intern (number, n.c_str(), n.size());
     }
 
     Tag::Tag (const char *n, unsigned int seed)
-        : name (n), number (simple_hash (n, strlen (n), seed)) 
+        : number (simple_hash (n, strlen (n), seed)) 
     {
+        name = intern (number, n, strlen (n));
     }
 
     bool Tag::operator== (const Tag &r) const
@@ -116,14 +321,14 @@ namespace Scaffold
     {
     }
 
-    Tag Tagged::tag() const
+    const Tag &Tagged::tag() const
     { 
         return tag_; 
     }
 
-    string Tagged::name() const
+    const string &Tagged::name() const
     { 
-        return tag_.name; 
+        return *tag_.name; 
     }
 
     bool Tagged::operator== (const Tagged &r) const
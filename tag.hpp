@@ -1,4 +1,4 @@
-/* tag.hpp -- identifies class by string name or 4-byte integer
+/* tag.hpp -- identifies class by string name or 8-byte integer
  *
  *			Ryan McDougall
  */
@@ -8,8 +8,25 @@
 
 namespace Scaffold
 {
+    // tags hash to 64 bits, so distinct names all but never collide; 
+    // define TAG_HASH32 for the older 32-bit MurmurHash2 numbering
+#ifdef TAG_HASH32
     typedef unsigned int tag_t;
+#else
+    typedef uint64_t tag_t;
+#endif
 
+    // both hashes a tag may be numbered by, for comparing them directly
+    unsigned int murmur_hash2 (const void *key, int len, unsigned int seed);
+    uint64_t wy_hash (const void *key, size_t len, uint64_t seed);
+
+    // names are interned in a process-wide table, so a tag is a hash and 
+    // a pointer and copies for free; building one still hashes and looks 
+    // up its name (without locking, once the name is known), so tags used
+    // on hot paths are best kept as named constants rather than literals
+    //
+    // tags compare by hash alone; debug builds assert that no two 
+    // interned names share one
     struct Tag
     {
         typedef std::set <Tag> Set;
@@ -24,8 +41,8 @@ namespace Scaffold
         bool operator< (const Tag &r) const;
         bool operator> (const Tag &r) const;
 
-        string  name;
-        tag_t   number; 
+        const string    *name;
+        tag_t           number; 
     };
 
     class Tagged
@@ -33,8 +50,8 @@ namespace Scaffold
         public:
             Tagged (const Tag &t);
 
-            Tag tag() const;
-            string name() const;
+            const Tag &tag() const;
+            const string &name() const;
 
             bool operator== (const Tagged &r) const;
             bool operator!= (const Tagged &r) const;
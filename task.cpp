@@ -3,7 +3,13 @@
  *			Ryan McDougall
  */
 
+#include <QTime>
+#include <QThreadStorage>
+
 #include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
 #include "task.hpp"
 
 //=============================================================================
@@ -12,81 +18,1362 @@ namespace Scaffold
 {
     namespace Framework
     {
-        Task::Task (Callable t) : 
-            work (t) 
+        // free-list of task-sized blocks, grown a chunk at a time
+        class TaskPool
+        {
+            public:
+                TaskPool () : free_ (0) {}
+
+                ~TaskPool ()
+                {
+                    for_each (chunks_.begin(), chunks_.end(), 
+                            safe_array_delete <char>);
+                }
+
+                void *allocate ()
+                {
+                    Locker mtx (lock_);
+
+                    if (!free_) 
+                        grow_ ();
+
+                    Block *block = free_;
+                    free_ = block->next;
+
+                    return block;
+                }
+
+                void release (void *ptr)
+                {
+                    Locker mtx (lock_);
+
+                    Block *block = static_cast <Block *> (ptr);
+                    block->next = free_;
+                    free_ = block;
+                }
+
+            private:
+                struct Block 
+                { 
+                    Block *next; 
+                };
+
+                void grow_ ()
+                {
+                    char *chunk = new char [TASK_POOL_CHUNK * sizeof (Task)];
+                    chunks_.push_back (chunk);
+
+                    for (size_t i = 0; i < TASK_POOL_CHUNK; ++i)
+                        release_ (chunk + i * sizeof (Task));
+                }
+
+                void release_ (void *ptr)
+                {
+                    Block *block = static_cast <Block *> (ptr);
+                    block->next = free_;
+                    free_ = block;
+                }
+
+            private:
+                Block                   *free_;
+                std::vector <char *>    chunks_;
+                Mutex                   lock_;
+        };
+
+        static TaskPool task_pool;
+
+        // how deep in task work each thread is, so enqueue knows when 
+        // blocking would stall the very workers that have to make room
+        static QThreadStorage <int *> task_depth;
+
+        static int &running_tasks ()
+        {
+            if (!task_depth.hasLocalData ())
+                task_depth.setLocalData (new int (0));
+
+            return *task_depth.localData ();
+        }
+
+        static int priority_level (int priority)
+        {
+            return std::min (std::max (priority, (int) Task::LOW), 
+                    (int) Task::PRIORITIES - 1);
+        }
+
+        TaskGroup::TaskGroup () : 
+            cancelled_ (0), count_ (0) 
+        {}
+
+        void TaskGroup::cancel () 
+        { 
+            cancelled_ = 1; 
+        }
+
+        bool TaskGroup::cancelled () const 
+        { 
+            return cancelled_ != 0; 
+        }
+
+        void TaskGroup::reset () 
+        { 
+            assert (count_ == 0);
+            cancelled_ = 0; 
+        }
+
+        bool TaskGroup::wait (unsigned long msec)
+        {
+            Locker mtx (lock_);
+
+            while (count_ > 0)
+                if (!drained_.wait (&lock_, msec))
+                    break;
+
+            return count_ == 0;
+        }
+
+        int TaskGroup::length () const 
+        { 
+            return count_; 
+        }
+
+        void TaskGroup::add () 
+        { 
+            count_.ref (); 
+        }
+
+        void TaskGroup::remove ()
+        {
+            // count down under the lock, so a waiter that sees zero can't 
+            // return and destroy the group before the wake is done with it
+            Locker mtx (lock_);
+
+            if (!count_.deref ())
+                drained_.wakeAll ();
+        }
+
+        //=========================================================================
+        //
+        Task::Task (Callable t, int p, int l) : 
+            state (INITIAL), priority (p), lane (l), work (t), link (0), 
+            name (0), queued (0), group (0), key (0)
         {}
 
         Task *Task::chain (Task *t) 
         { 
+            t->predecessors.ref ();
             dependants.push_back (t); 
+
+            if (group && !t->group)
+                t->within (group);
+
+            return this;
+        }
+
+        Task *Task::after (Task *parent) 
+        { 
+            parent->chain (this);
+            return this;
+        }
+
+        Task *Task::wait (Predicate condition) 
+        { 
+            until = condition;
+            return this;
+        }
+
+        Task *Task::named (const char *n) 
+        { 
+            name = n;
             return this;
         }
+
+        Task *Task::within (TaskGroup *g)
+        {
+            if (group)
+                group->remove ();
+
+            group = g;
+            group->add ();
+
+            for (size_t n = 0; n < dependants.size(); ++n)
+                if (!dependants [n]->group)
+                    dependants [n]->within (g);
+
+            return this;
+        }
+
+        Task *Task::coalesce (size_t k)
+        {
+            key = k;
+            return this;
+        }
+
+        void *Task::operator new (size_t size)
+        {
+            // derived tasks don't fit the pool's blocks
+            if (size != sizeof (Task))
+                return ::operator new (size);
+
+            return task_pool.allocate ();
+        }
+
+        void Task::operator delete (void *ptr, size_t size)
+        {
+            if (!ptr)
+                return;
+
+            if (size != sizeof (Task))
+                ::operator delete (ptr);
+            else
+                task_pool.release (ptr);
+        }
         
 
-        Scheduler::Scheduler ()
+        Mailbox::Mailbox () : 
+            head_ (0), cache_ (0)
         {
         }
 
-        void Scheduler::enqueue (Task *task)
+        void Mailbox::post (Task *task)
         {
-            Locker mtx (queue_lock_);
+            Task *head;
 
-            enqueue_ (task);
+            do
+            {
+                head = head_;
+                task->link = head;
+            }
+            while (!head_.testAndSetOrdered (head, task));
+
+            count_.ref ();
         }
 
-        void Scheduler::enqueue (const Task::List &list)
+        Task *Mailbox::pop ()
         {
-            Locker mtx (queue_lock_);
+            // posts arrive newest first; take the lot and reverse into fifo
+            if (!cache_)
+            {
+                Task *head = head_.fetchAndStoreOrdered (0);
+
+                while (head)
+                {
+                    Task *next = head->link;
+                    head->link = cache_;
+                    cache_ = head;
+                    head = next;
+                }
+            }
+
+            Task *task = cache_;
+
+            if (task)
+            {
+                cache_ = task->link;
+                task->link = 0;
+                count_.deref ();
+            }
+
+            return task;
+        }
+
+        int Mailbox::length ()
+        {
+            return count_;
+        }
+
+        //---------------------------------------------------------------------
+
+        Scheduler::Scheduler (int workers) :
+            aging_ (SCHEDULER_AGING_LIMIT), injected_ (0), capacity_ (0), 
+            policy_ (BLOCK), blocked_ (0), trace_ (0)
+        {
+            std::fill (starved_, starved_ + Task::PRIORITIES, 0);
+
+            for (int i = 0; i < std::max (workers, 1); ++i)
+                deques_.push_back (new Deque);
+        }
+
+        Scheduler::~Scheduler ()
+        {
+            for_each (deques_.begin(), deques_.end(), 
+                    safe_delete <Deque>);
+
+            delete trace_;
+        }
+
+        bool Scheduler::enqueue (Task *task)
+        {
+            if (task->lane != Task::ANY_LANE)
+            {
+                post_ (task);
+                return true;
+            }
+
+            {
+                Locker mtx (queue_lock_);
+
+                if (!admit_ (task, true))
+                    return false;
+
+                enqueue_ (task);
+            }
+
+            signal_ (1);
+            return true;
+        }
+
+        int Scheduler::enqueue (const Task::List &list)
+        {
+            int count = 0, posted = 0;
+
+            {
+                Locker mtx (queue_lock_);
+
+                Task::List::const_iterator i = list.begin();
+                Task::List::const_iterator e = list.end();
+                for (; i != e; ++i) 
+                {
+                    if ((*i)->lane != Task::ANY_LANE)
+                        post_ (*i), ++posted;
+                    else if (admit_ (*i, true))
+                        enqueue_ (*i), ++count;
+                }
+            }
+
+            signal_ (count);
+            return count + posted;
+        }
 
-            enqueue_ (list);
+        bool Scheduler::tryEnqueue (Task *task)
+        {
+            if (task->lane != Task::ANY_LANE)
+            {
+                post_ (task);
+                return true;
+            }
+
+            {
+                Locker mtx (queue_lock_);
+
+                if (!admit_ (task, false))
+                    return false;
+
+                enqueue_ (task);
+            }
+
+            signal_ (1);
+            return true;
         }
 
         void Scheduler::dispatch (frame_delta_t delta)
         {
-            if (queue_.size())
+            dispatch (0, delta);
+        }
+
+        bool Scheduler::dispatch (int worker, frame_delta_t delta)
+        {
+            return dispatch_ (worker, delta, true);
+        }
+
+        bool Scheduler::dispatch_ (int worker, frame_delta_t delta, bool background)
+        {
+            assert (worker >= 0 && worker < workers ());
+
+            // look at parked tasks now and then, and whenever we run dry
+            if (suspended_ > 0 && !(ticks_.fetchAndAddRelaxed (1) % SCHEDULER_RESUME_INTERVAL))
+                resume_ (worker, delta);
+
+            Task *head = next_ (worker);
+
+            if (!head && suspended_ > 0 && resume_ (worker, delta))
+                head = next_ (worker);
+
+            // nothing else to do, so spare time goes to background work
+            if (!head && background)
+                head = pop_background_ ();
+
+            if (!head) return false;
+
+            run_ (worker, head, delta);
+
+            return true;
+        }
+
+        Scheduler::Slice Scheduler::dispatch (int worker, frame_delta_t delta, frame_delta_t budget)
+        {
+            Slice slice = { 0, 0, 0 };
+            QTime time; time.start ();
+
+            // stop at the first task boundary past the budget
+            while (slice.elapsed < budget && dispatch_ (worker, delta, 
+                        budget - slice.elapsed >= SCHEDULER_BACKGROUND_SLACK))
+            {
+                ++ slice.dispatched;
+                slice.elapsed = time.elapsed ();
+            }
+
+            // whatever is still waiting on this worker's deque rolls over
+            // to the next frame
+            Deque *local = deques_ [worker];
+
+            if (slice.elapsed >= budget)
             {
-                Task *head = queue_.front();
+                Locker mtx (local->lock);
+                slice.carried = local->tasks.size();
+            }
+
+            local->carried = slice.carried;
 
-                if (execute_ (head, delta) && head->dependants.size())
-                    enqueue_ (head->dependants);
+            return slice;
+        }
+
+        int Scheduler::drain (int lane, frame_delta_t delta)
+        {
+            assert (lane == Task::MAIN_LANE);
+
+            // main lane conditions are only ever tested here, on the main thread
+            if (suspended_ > 0)
+                resume_ (lane, delta);
 
-                dispose_ (head);
+            // only what is waiting now; anything posted meanwhile waits a frame
+            int count = main_.length ();
+            int dispatched = 0;
 
-                queue_.pop_front();
+            Task *head;
+            while (count-- && (head = main_.pop ()))
+            {
+                run_ (lane, head, delta);
+                ++ dispatched;
             }
+
+            return dispatched;
+        }
+
+        bool Scheduler::help (TaskGroup *group, frame_delta_t delta)
+        {
+            Task *head = take_ (group);
+            if (!head) return false;
+
+            run_ (Task::MAIN_LANE, head, delta);
+
+            return true;
+        }
+
+        bool Scheduler::wait (int worker, unsigned long msec)
+        {
+            assert (worker >= 0 && worker < workers ());
+
+            Deque *local = deques_ [worker];
+            Locker mtx (idle_lock_);
+
+            // parked tasks need polling, so don't sleep long while there are any
+            if (suspended_ > 0) 
+                msec = std::min (msec, SCHEDULER_RESUME_WAIT);
+
+            // announce before checking, so enqueue either sees a sleeper
+            // or we see its work; the timeout bounds any other latency
+            // only our own mailbox counts; other lanes' pinned work is theirs
+            sleepers_.ref ();
+            local->sleeping = true;
+
+            bool woken = (ready_ > 0) || local->mailbox.length () || 
+                local->wake.wait (&idle_lock_, msec);
+
+            local->sleeping = false;
+            sleepers_.deref ();
+
+            return woken;
+        }
+
+        void Scheduler::wake ()
+        {
+            Locker mtx (idle_lock_);
+
+            for (int i = 0; i < workers (); ++i)
+                deques_ [i]->wake.wakeAll ();
         }
 
         int Scheduler::length ()
         {
-            return queue_.size();
+            return pending_ + suspended_;
         }
 
-        void Scheduler::enqueue_ (Task *task)
+        TimerWheel::Id Scheduler::schedule (Task::Callable work, int delay, int period, int priority)
         {
-            task->state = Task::READY;
+            return timers_.insert (work, priority, delay, period);
+        }
 
-            queue_.push_back (task);
+        bool Scheduler::cancel (TimerWheel::Id timer)
+        {
+            return timers_.cancel (timer);
         }
 
-        void Scheduler::enqueue_ (const Task::List &list)
+        void Scheduler::advance (frame_delta_t elapsed)
         {
-            Task::List::const_iterator i = list.begin();
-            Task::List::const_iterator e = list.end();
-            for (; i != e; ++i) enqueue_ (*i);
+            Task::Queue expired;
+            timers_.advance (elapsed, expired);
+
+            if (!expired.empty())
+                inject_ (expired);
         }
 
-        bool Scheduler::execute_ (Task *head, frame_delta_t delta)
+        void Scheduler::nameLane (int worker, const string &name)
         {
-            head->state = Task::RUNNING;
-            bool result = head->work (delta);
-            head->state = Task::COMPLETE;
+            assert (worker >= 0 && worker < workers ());
 
-            return result;
+            lanes_ [name] = worker;
         }
 
-        void Scheduler::dispose_ (Task *head) 
+        int Scheduler::lane (const string &name) const
         {
-            head->state = Task::FINAL;
+            std::map <string, int>::const_iterator i = lanes_.find (name);
+            return (i != lanes_.end())? i->second : (int) Task::ANY_LANE;
+        }
+
+        void Scheduler::setTracing (bool enable)
+        {
+            // created once and kept, so a racing worker never sees it freed
+            if (enable && !trace_)
+                trace_ = new TaskTrace (workers () + 1);
+
+            tracing_ = enable;
+        }
+
+        TaskTrace *Scheduler::trace ()
+        {
+            return trace_;
+        }
+
+        int Scheduler::carried ()
+        {
+            int count = 0;
+
+            for (int i = 0; i < workers (); ++i)
+                count += deques_ [i]->carried;
+
+            return count;
+        }
+
+        int Scheduler::depth (int priority)
+        {
+            if (priority == Task::BACKGROUND)
+                return background_depth_;
+
+            return depth_ [priority_level (priority)];
+        }
+
+        int Scheduler::workers () const
+        {
+            return deques_.size();
+        }
+
+        void Scheduler::setCapacity (int tasks, int policy)
+        {
+            Locker mtx (queue_lock_);
+
+            capacity_ = tasks;
+            policy_ = policy;
+
+            // release anyone blocked on the old limit
+            space_.wakeAll ();
+        }
+
+        bool Scheduler::saturated ()
+        {
+            return saturated_;
+        }
+
+        int Scheduler::rejected ()
+        {
+            return rejected_;
+        }
+
+        void Scheduler::setAgingLimit (int dispatches)
+        {
+            Locker mtx (queue_lock_);
+
+            aging_ = std::max (dispatches, 1);
+        }
+
+        Task *Scheduler::next_ (int worker)
+        {
+            Task *head = pop_injected_ (Task::HIGH);
+
+            if (!head) head = deques_ [worker]->mailbox.pop ();
+            if (!head) head = pop_local_ (worker);
+            if (!head) head = pop_injected_ (Task::LOW);
+            if (!head) head = steal_ (worker);
+
+            return head;
+        }
+
+        void Scheduler::run_ (int worker, Task *head, frame_delta_t delta)
+        {
+            if (head->group && head->group->cancelled ())
+            {
+                drop_ (head);
+                return;
+            }
+
+            // not ready to start yet; park it rather than run it
+            if (!head->until.empty() && !head->until (delta))
+            {
+                suspend_ (head);
+                return;
+            }
+
+            int &depth = running_tasks ();
+
+            ++ depth;
+            int result = execute_ (worker, head, delta);
+            -- depth;
+
+            if (result == Task::YIELD)
+            {
+                suspend_ (head);
+                return;
+            }
+
+            if (head->dependants.size())
+            {
+                if (result)
+                    release_ (worker, head->dependants);
+                else
+                    fail_ (head);
+            }
+
+            dispose_ (head);
+
+            // count down only after dependants are visible
+            pending_.deref ();
+        }
+
+        void Scheduler::drop_ (Task *head)
+        {
+            head->state = Task::ERROR;
+
+            // a dropped task never completed, so whatever follows it fails 
+            // as it would after a failure, whichever group it is in
+            if (head->dependants.size())
+                fail_ (head);
+
+            dispose_ (head);
+            pending_.deref ();
+        }
+
+        void Scheduler::fail_ (Task *head)
+        {
+            // dependants of a failed task can never run. each is marked at 
+            // once, so a join whose other predecessors finish later is 
+            // thrown away rather than run, and the last predecessor out 
+            // disposes of it and its own dependants in turn. none were 
+            // ever counted pending, so only their group hears of it
+            for (size_t n = 0; n < head->dependants.size(); ++n)
+            {
+                Task *task = head->dependants [n];
+                task->state = Task::ERROR;
+
+                if (!task->predecessors.deref ())
+                {
+                    fail_ (task);
+                    dispose_ (task);
+                }
+            }
+        }
+
+        void Scheduler::post_ (Task *task)
+        {
+            int lane = task->lane;
+
+            ready_stamp_ (task);
+            pending_.ref ();
+
+            if (lane == Task::MAIN_LANE)
+                main_.post (task);
+
+            else
+            {
+                assert (lane >= 0 && lane < workers ());
+
+                deques_ [lane]->mailbox.post (task);
+
+                // nobody else can run it, so wake just its owner
+                signal_lane_ (lane);
+            }
+        }
+
+        void Scheduler::ready_stamp_ (Task *task)
+        {
+            task->state = Task::READY;
+
+            if (tracing_)
+                task->queued = Clock::now ();
+        }
+
+        void Scheduler::suspend_ (Task *task)
+        {
+            // a bare yield just goes to the back of the line
+            if (task->until.empty())
+                inject_ (task);
+
+            else
+            {
+                task->state = Task::SUSPENDED;
+
+                Locker mtx (parked_lock_);
+                parked_.push_back (task);
+                suspended_.ref ();
+            }
+
+            pending_.deref ();
+        }
+
+        int Scheduler::resume_ (int lane, frame_delta_t delta)
+        {
+            Task::Queue parked, waiting, ready;
+
+            {
+                Locker mtx (parked_lock_);
+                parked.append (parked_);
+            }
+
+            // test conditions outside the lock so parking never waits on them;
+            // cancelled tasks come back only to be dropped. a pinned task's
+            // condition may touch state owned by its lane, so only that lane
+            // tests it
+            while (Task *task = parked.pop_front ())
+                if (task->group && task->group->cancelled ())
+                    ready.push_back (task);
+                else if (task->lane != Task::ANY_LANE && task->lane != lane)
+                    waiting.push_back (task);
+                else if (task->until (delta))
+                    ready.push_back (task);
+                else
+                    waiting.push_back (task);
+
+            {
+                Locker mtx (parked_lock_);
+                parked_.append (waiting);
+            }
+
+            int resumed = ready.size();
+
+            if (resumed)
+            {
+                inject_ (ready);
+                suspended_.fetchAndAddOrdered (-resumed);
+            }
+
+            return resumed;
+        }
+
+        void Scheduler::inject_ (Task *task)
+        {
+            if (task->lane != Task::ANY_LANE)
+            {
+                post_ (task);
+                return;
+            }
+
+            {
+                Locker mtx (queue_lock_);
+                enqueue_ (task);
+            }
+
+            signal_ (1);
+        }
+
+        void Scheduler::inject_ (Task::Queue &list)
+        {
+            int count = 0;
+
+            {
+                Locker mtx (queue_lock_);
+
+                while (Task *task = list.pop_front ())
+                {
+                    if (task->lane != Task::ANY_LANE)
+                        post_ (task);
+                    else
+                        enqueue_ (task), ++count;
+                }
+            }
+
+            signal_ (count);
+        }
+
+        bool Scheduler::admit_ (Task *task, bool block)
+        {
+            if (!capacity_ || injected_ < capacity_)
+                return true;
+
+            // a task producing more work can't wait for space its own 
+            // thread would have to free, so it is let past capacity
+            if (policy_ == BLOCK && block && running_tasks ())
+                return true;
+
+            if (policy_ == BLOCK && block)
+            {
+                ++ blocked_;
+                while (capacity_ && injected_ >= capacity_)
+                    space_.wait (&queue_lock_);
+                -- blocked_;
+
+                return true;
+            }
+
+            if (policy_ == COALESCE && coalesce_ (task))
+                return false;
+
+            // nothing chained on it can run now; failing them gives 
+            // their group its counts back, so a wait on it still drains
+            rejected_.ref ();
+            fail_ (task);
+            dispose_ (task);
+
+            return false;
+        }
+
+        bool Scheduler::coalesce_ (Task *task)
+        {
+            if (!task->key || task->dependants.size())
+                return false;
+
+            std::map <size_t, Task *>::iterator i = keyed_.find (task->key);
+            if (i == keyed_.end() || i->second->dependants.size())
+                return false;
+
+            // the waiting task keeps its place but takes the newer work
+            Task *waiting = i->second;
+            waiting->work = task->work;
+            waiting->until = task->until;
+            waiting->name = task->name;
+
+            dispose_ (task);
+
+            return true;
+        }
+
+        void Scheduler::enqueue_ (Task *task)
+        {
+            int level = priority_level (task->priority);
+            ready_stamp_ (task);
+
+            if (task->key)
+                keyed_ [task->key] = task;
+
+            ++ injected_;
+            if (capacity_ && injected_ * 100 >= capacity_ * SCHEDULER_HIGH_WATER)
+                saturated_ = 1;
+
+            // kept out of ready_, so idle waits and carry-over ignore it
+            if (task->priority == Task::BACKGROUND)
+            {
+                background_.push_back (task);
+                background_depth_.ref ();
+                pending_.ref ();
+                return;
+            }
+
+            queue_ [level].push_back (task);
+            depth_ [level].ref ();
+            pending_.ref ();
+            ready_.ref ();
+        }
+
+        void Scheduler::release_ (int worker, const Task::Dependants &list)
+        {
+            // the main thread has no deque; hand its dependants to the pool
+            if (worker == Task::MAIN_LANE)
+            {
+                Task::Queue ready;
+
+                for (size_t n = 0; n < list.size(); ++n)
+                {
+                    Task *task = list [n];
+
+                    if (task->predecessors.deref ())
+                        continue;
+
+                    if (task->state == Task::ERROR)
+                    {
+                        fail_ (task);
+                        dispose_ (task);
+                    }
+                    else
+                        ready.push_back (task);
+                }
+
+                inject_ (ready);
+                return;
+            }
+
+            int released = 0;
+            Task::Queue background;
+
+            {
+                Deque *local = deques_ [worker];
+                Locker mtx (local->lock);
+
+                // owner pops from the back, so push in reverse to keep chain order
+                for (size_t n = list.size(); n--; ) 
+                {
+                    Task *task = list [n];
+
+                    // joins wait until the last of their predecessors completes
+                    if (task->predecessors.deref ())
+                        continue;
+
+                    // another predecessor failed, so it can never run
+                    if (task->state == Task::ERROR)
+                    {
+                        fail_ (task);
+                        dispose_ (task);
+                        continue;
+                    }
+
+                    if (task->lane != Task::ANY_LANE)
+                    {
+                        post_ (task);
+                        continue;
+                    }
+
+                    if (task->priority == Task::BACKGROUND)
+                    {
+                        background.push_front (task);
+                        continue;
+                    }
+
+                    ++released;
+                    ready_stamp_ (task);
+
+                    local->tasks.push_back (task);
+                    depth_ [priority_level (task->priority)].ref ();
+                    pending_.ref ();
+                    ready_.ref ();
+                }
+            }
+
+            if (!background.empty())
+                inject_ (background);
+
+            // this worker takes one; wake others to steal the rest
+            signal_ (released - 1);
+        }
+
+        Task *Scheduler::pop_local_ (int worker)
+        {
+            Task *head = 0;
+            Deque *local = deques_ [worker];
+            Locker mtx (local->lock);
+
+            if (local->tasks.size())
+            {
+                head = local->tasks.back();
+                local->tasks.pop_back();
+                depth_ [priority_level (head->priority)].deref ();
+                ready_.deref ();
+            }
+
+            return head;
+        }
+
+        Task *Scheduler::pop_injected_ (int floor)
+        {
+            Task *head = 0;
+
+            // cheap early out so the urgent pass costs no lock when idle
+            int waiting = 0;
+            for (int i = floor; i < Task::PRIORITIES; ++i)
+                waiting += depth_ [i];
+
+            if (!waiting) 
+                return head;
+
+            Locker mtx (queue_lock_);
+
+            // find the most urgent non-empty level at or above the floor
+            int level = Task::PRIORITIES;
+            while (level-- > floor)
+                if (!queue_ [level].empty()) 
+                    break;
+
+            if (level >= floor)
+            {
+                // age every level passed over, even below the floor, 
+                // and serve one that has starved long enough first
+                for (int i = Task::LOW; i < level; ++i)
+                    if (!queue_ [i].empty() && ++starved_ [i] >= aging_)
+                    {
+                        level = i;
+                        break;
+                    }
+
+                starved_ [level] = 0;
+
+                head = queue_ [level].pop_front();
+                depth_ [level].deref ();
+                ready_.deref ();
+
+                leave_queue_ (head);
+            }
+
+            return head;
+        }
+
+        void Scheduler::leave_queue_ (Task *head)
+        {
+            if (head->key)
+            {
+                std::map <size_t, Task *>::iterator i = keyed_.find (head->key);
+                if (i != keyed_.end() && i->second == head)
+                    keyed_.erase (i);
+            }
+
+            -- injected_;
+            if (injected_ * 100 <= capacity_ * SCHEDULER_LOW_WATER)
+                saturated_ = 0;
+
+            if (blocked_)
+                space_.wakeOne ();
+        }
+
+        Task *Scheduler::pop_background_ ()
+        {
+            Task *head = 0;
+
+            if (!background_depth_)
+                return head;
+
+            Locker mtx (queue_lock_);
+
+            if ((head = background_.pop_front ()))
+            {
+                background_depth_.deref ();
+
+                leave_queue_ (head);
+            }
+
+            return head;
+        }
+
+        Task *Scheduler::steal_ (int worker)
+        {
+            Task *head = 0;
+            int count = workers ();
+
+            // a worker skips its own deque; any other thread tries them all
+            int first = (worker >= 0)? 1 : 0;
+            int start = (worker >= 0)? worker : 0;
+
+            // thieves take the oldest work from the front of a victim's deque
+            for (int i = first; !head && i < count; ++i)
+            {
+                Deque *victim = deques_ [(start + i) % count];
+                Locker mtx (victim->lock);
+
+                if (victim->tasks.size())
+                {
+                    head = victim->tasks.front();
+                    victim->tasks.pop_front();
+                    depth_ [priority_level (head->priority)].deref ();
+                    ready_.deref ();
+                }
+            }
+
+            return head;
+        }
+
+        Task *Scheduler::take_ (TaskGroup *group)
+        {
+            Task *head = 0;
+
+            // search, rather than pop, so only the group's own work is taken
+            if (ready_ > 0)
+            {
+                Locker mtx (queue_lock_);
+
+                for (int level = Task::PRIORITIES; !head && level-- > Task::LOW; )
+                    if ((head = queue_ [level].take (group)))
+                    {
+                        depth_ [level].deref ();
+                        ready_.deref ();
+
+                        leave_queue_ (head);
+                    }
+            }
+
+            for (int i = 0; !head && i < workers (); ++i)
+            {
+                Deque *victim = deques_ [i];
+                Locker mtx (victim->lock);
+
+                std::deque <Task *>::iterator t = victim->tasks.begin();
+                for (; t != victim->tasks.end(); ++t)
+                    if ((*t)->group == group)
+                    {
+                        head = *t;
+                        victim->tasks.erase (t);
+                        depth_ [priority_level (head->priority)].deref ();
+                        ready_.deref ();
+                        break;
+                    }
+            }
+
+            return head;
+        }
+
+        //---------------------------------------------------------------------
+
+        // ids carry the slab index in the low bits, a reuse count in the high
+        static const int TIMER_INDEX_BITS (20);
+        static const uint32_t TIMER_INDEX_MASK ((1 << TIMER_INDEX_BITS) - 1);
+
+        static int timer_slot (uint64_t expires, int level)
+        {
+            return (expires >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+        }
+
+        TimerWheel::TimerWheel () :
+            free_ (-1), count_ (0), now_ (0)
+        {
+            std::fill (buckets_, buckets_ + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, -1);
+        }
+
+        TimerWheel::Id TimerWheel::insert (const Task::Callable &work, int priority, int delay, int period)
+        {
+            Locker mtx (lock_);
+
+            int index = allocate_ ();
+            Timer &t = timers_ [index];
+
+            t.work = work;
+            t.priority = priority;
+            t.period = std::max (period, 0);
+            t.expires = now_ + std::max (delay, 1);
+
+            link_ (index);
+            ++ count_;
+
+            return (t.generation << TIMER_INDEX_BITS) | index;
+        }
+
+        bool TimerWheel::cancel (Id id)
+        {
+            Locker mtx (lock_);
+
+            int index = id & TIMER_INDEX_MASK;
+
+            // stale ids (already fired or cancelled) no longer match
+            if (index >= (int) timers_.size() || 
+                    timers_ [index].bucket < 0 ||
+                    timers_ [index].generation != (id >> TIMER_INDEX_BITS))
+                return false;
+
+            unlink_ (index);
+            release_ (index);
+            -- count_;
+
+            return true;
+        }
+
+        void TimerWheel::advance (frame_delta_t elapsed, Task::Queue &expired)
+        {
+            Locker mtx (lock_);
+
+            while (elapsed-- > 0)
+            {
+                ++ now_;
+
+                // pull the next span down from coarser levels as each wraps
+                for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+                {
+                    if (timer_slot (now_, level - 1) != 0)
+                        break;
+
+                    cascade_ (level);
+                }
+
+                int bucket = timer_slot (now_, 0);
+
+                while (buckets_ [bucket] >= 0)
+                {
+                    int index = buckets_ [bucket];
+                    Timer &t = timers_ [index];
+
+                    unlink_ (index);
+                    expired.push_back (new Task (t.work, t.priority));
+
+                    if (t.period)
+                    {
+                        t.expires = now_ + t.period;
+                        link_ (index);
+                    }
+                    else
+                    {
+                        release_ (index);
+                        -- count_;
+                    }
+                }
+            }
+        }
+
+        int TimerWheel::length ()
+        {
+            Locker mtx (lock_);
+
+            return count_;
+        }
+
+        int TimerWheel::allocate_ ()
+        {
+            if (free_ < 0)
+            {
+                assert (timers_.size() <= TIMER_INDEX_MASK);
+                timers_.push_back (Timer ());
+
+                return timers_.size() - 1;
+            }
+
+            int index = free_;
+            free_ = timers_ [index].next;
+
+            return index;
+        }
+
+        void TimerWheel::release_ (int index)
+        {
+            Timer &t = timers_ [index];
+
+            t.work = Task::Callable ();
+            t.generation = (t.generation + 1) & (~0u >> TIMER_INDEX_BITS);
+            t.generation += !t.generation;
+            t.bucket = -1;
+            t.prev = -1;
+            t.next = free_;
+
+            free_ = index;
+        }
+
+        void TimerWheel::link_ (int index)
+        {
+            Timer &t = timers_ [index];
+            uint64_t delta = (t.expires > now_)? t.expires - now_ : 1;
+
+            // coarsest level whose span still covers the delay
+            int level = 0;
+            while (level < TIMER_WHEEL_LEVELS - 1 && 
+                    delta >= ((uint64_t) 1 << ((level + 1) * TIMER_WHEEL_BITS)))
+                ++ level;
+
+            // clamp anything past the wheel's horizon to its far edge
+            if (delta >= ((uint64_t) 1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)))
+                t.expires = now_ + ((uint64_t) 1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1;
+
+            t.bucket = level * TIMER_WHEEL_SLOTS + timer_slot (t.expires, level);
+            t.prev = -1;
+            t.next = buckets_ [t.bucket];
+
+            if (t.next >= 0)
+                timers_ [t.next].prev = index;
+
+            buckets_ [t.bucket] = index;
+        }
+
+        void TimerWheel::unlink_ (int index)
+        {
+            Timer &t = timers_ [index];
+
+            if (t.prev >= 0)
+                timers_ [t.prev].next = t.next;
+            else
+                buckets_ [t.bucket] = t.next;
+
+            if (t.next >= 0)
+                timers_ [t.next].prev = t.prev;
+
+            t.bucket = -1;
+            t.prev = -1;
+            t.next = -1;
+        }
+
+        void TimerWheel::cascade_ (int level)
+        {
+            int bucket = level * TIMER_WHEEL_SLOTS + timer_slot (now_, level);
+
+            // re-link each timer; it lands on a finer level now it's closer
+            while (buckets_ [bucket] >= 0)
+            {
+                int index = buckets_ [bucket];
+
+                unlink_ (index);
+                link_ (index);
+            }
+        }
+
+        //---------------------------------------------------------------------
+
+        void Scheduler::signal_ (int count)
+        {
+            // skip the lock entirely when no worker is asleep
+            if (count > 0 && sleepers_ > 0)
+            {
+                Locker mtx (idle_lock_);
+
+                // a sleeper stays marked until it runs again, so a burst of
+                // single signals lands on the one already waking rather 
+                // than rousing every worker for a handful of tasks
+                for (int i = 0; i < workers () && count > 0; ++i)
+                    if (deques_ [i]->sleeping)
+                    {
+                        deques_ [i]->wake.wakeOne ();
+                        -- count;
+                    }
+            }
+        }
+
+        void Scheduler::signal_lane_ (int worker)
+        {
+            if (sleepers_ > 0)
+            {
+                Locker mtx (idle_lock_);
+
+                if (deques_ [worker]->sleeping)
+                    deques_ [worker]->wake.wakeOne ();
+            }
+        }
+
+        int Scheduler::execute_ (int worker, Task *head, frame_delta_t delta)
+        {
+            if (!tracing_)
+            {
+                head->state = Task::RUNNING;
+                int result = head->work (delta);
+                head->state = Task::COMPLETE;
+
+                return result;
+            }
+
+            usec_t start = Clock::now ();
+
+            head->state = Task::RUNNING;
+            int result = head->work (delta);
+            head->state = Task::COMPLETE;
+
+            // tasks queued before tracing began have no stamp; count no wait
+            int thread = (worker == Task::MAIN_LANE)? workers () : worker;
+            trace_->record (head->name, thread, 
+                    head->queued? head->queued : start, start, Clock::now ());
+
+            return result;
+        }
+
+        void Scheduler::dispose_ (Task *head) 
+        {
+            head->state = Task::FINAL;
+
+            if (head->group)
+                head->group->remove ();
 
             delete head;
         }
@@ -10,50 +10,531 @@ namespace Scaffold
 {
     namespace Framework
     {
+        // upper bound on how long an idle worker sleeps before re-polling
+        const unsigned long SCHEDULER_IDLE_WAIT (50);
+
+        // dispatches a waiting priority level may be passed over before it is served
+        const int SCHEDULER_AGING_LIMIT (16);
+
+        // suspended tasks are re-checked every so many dispatches, and at
+        // least this often (msec) when workers are otherwise idle
+        const int SCHEDULER_RESUME_INTERVAL (32);
+        const unsigned long SCHEDULER_RESUME_WAIT (5);
+
+        // background work starts only with this much (msec) frame budget left
+        const frame_delta_t SCHEDULER_BACKGROUND_SLACK (2);
+
+        // backpressure is raised at the high mark and cleared at the low 
+        // mark, both in percent of injection queue capacity
+        const int SCHEDULER_HIGH_WATER (75);
+        const int SCHEDULER_LOW_WATER (50);
+
+        // timer wheel geometry: levels of 2^bits slots, one msec per tick
+        const int TIMER_WHEEL_BITS (6);
+        const int TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS);
+        const int TIMER_WHEEL_LEVELS (4);
+
+        // dependants kept in place before spilling to the heap
+        const size_t TASK_INLINE_DEPENDANTS (4);
+
+        // tasks carved from the heap at once when the free-list runs dry
+        const size_t TASK_POOL_CHUNK (64);
+
+        struct Task;
+
+        // a set of tasks that can be cancelled and waited on together; 
+        // also serves as the cancellation token work may poll
+        class TaskGroup
+        {
+            public:
+                TaskGroup ();
+
+                // tasks not yet started are dropped; running work may poll
+                void cancel ();
+                bool cancelled () const;
+
+                // clear cancellation so the group can be reused once drained
+                void reset ();
+
+                // block until every member has finished or been dropped
+                bool wait (unsigned long msec = ULONG_MAX);
+                int length () const;
+
+                void add ();
+                void remove ();
+
+            private:
+                Atomic      cancelled_;
+                Atomic      count_;
+                Mutex       lock_;
+                Condition   drained_;
+        };
+
         struct Task
         {
-            typedef function <bool(frame_delta_t)> Callable;
+            typedef Delegate <int(frame_delta_t)> Callable;
+            typedef Delegate <bool(frame_delta_t)> Predicate;
             typedef std::list <Task *> List;
 
+            class Dependants
+            {
+                public:
+                    Dependants () : count_ (0) {}
+
+                    void push_back (Task *t)
+                    {
+                        if (count_ < TASK_INLINE_DEPENDANTS)
+                            inline_ [count_] = t;
+                        else
+                            overflow_.push_back (t);
+
+                        ++ count_;
+                    }
+
+                    size_t size () const 
+                    { 
+                        return count_; 
+                    }
+
+                    Task *operator[] (size_t i) const
+                    {
+                        return (i < TASK_INLINE_DEPENDANTS)? 
+                            inline_ [i] : overflow_ [i - TASK_INLINE_DEPENDANTS];
+                    }
+
+                private:
+                    size_t                  count_;
+                    Task                    *inline_ [TASK_INLINE_DEPENDANTS];
+                    std::vector <Task *>    overflow_;
+            };
+
+            // fifo threaded through link, so queueing never allocates; a 
+            // task is in at most one queue or mailbox at a time
+            class Queue
+            {
+                public:
+                    Queue () : head_ (0), tail_ (0), size_ (0) {}
+
+                    void push_back (Task *t)
+                    {
+                        t->link = 0;
+
+                        if (tail_) tail_->link = t;
+                        else head_ = t;
+
+                        tail_ = t;
+                        ++ size_;
+                    }
+
+                    void push_front (Task *t)
+                    {
+                        t->link = head_;
+                        head_ = t;
+
+                        if (!tail_) tail_ = t;
+                        ++ size_;
+                    }
+
+                    Task *pop_front ()
+                    {
+                        Task *t = head_;
+
+                        if (t)
+                        {
+                            head_ = t->link;
+                            if (!head_) tail_ = 0;
+
+                            t->link = 0;
+                            -- size_;
+                        }
+
+                        return t;
+                    }
+
+                    // move all of q onto the back of this one
+                    void append (Queue &q)
+                    {
+                        if (!q.head_)
+                            return;
+
+                        if (tail_) tail_->link = q.head_;
+                        else head_ = q.head_;
+
+                        tail_ = q.tail_;
+                        size_ += q.size_;
+
+                        q.head_ = q.tail_ = 0;
+                        q.size_ = 0;
+                    }
+
+                    // unlink the first task in group g, if any
+                    Task *take (TaskGroup *g)
+                    {
+                        Task *prev = 0;
+                        for (Task *t = head_; t; prev = t, t = t->link)
+                            if (t->group == g)
+                            {
+                                if (prev) prev->link = t->link;
+                                else head_ = t->link;
+
+                                if (tail_ == t) tail_ = prev;
+
+                                t->link = 0;
+                                -- size_;
+
+                                return t;
+                            }
+
+                        return 0;
+                    }
+
+                    Task *front () const { return head_; }
+                    size_t size () const { return size_; }
+                    bool empty () const { return !head_; }
+
+                private:
+                    Task    *head_;
+                    Task    *tail_;
+                    size_t  size_;
+            };
+
             enum 
             {
                 INITIAL,
                 READY,
                 RUNNING,
+                SUSPENDED,
                 COMPLETE,
                 FINAL,
                 ERROR
             };
 
+            // background work only runs in spare time; see Scheduler
+            enum
+            {
+                BACKGROUND = -1,
+                LOW,
+                NORMAL,
+                HIGH,
+                CRITICAL,
+                PRIORITIES
+            };
+
+            // lanes pin a task to a thread; workers are lanes 0..n-1
+            enum
+            {
+                ANY_LANE = -1,
+                MAIN_LANE = -2
+            };
+
+            // work returns one of these; plain bool work maps onto the first two
+            enum
+            {
+                FAILURE,
+                SUCCESS,
+                YIELD
+            };
+
             int state;
             int priority;
+            int lane;
 
             Callable    work;
-            List        dependants;
+            Predicate   until;
+            Dependants  dependants;
+            Atomic      predecessors;
+            Task        *link;
 
-            Task (Callable t);
+            const char  *name;
+            usec_t      queued;
+
+            TaskGroup   *group;
+            size_t      key;
+
+            Task (Callable t, int p = NORMAL, int l = ANY_LANE);
+
+            // fan-out: t runs once this and all of t's other parents succeed;
+            // if any fails, t and everything after it is thrown away unrun
             Task *chain (Task *t);
+
+            // fan-in: this runs once parent and all other parents succeed
+            Task *after (Task *parent);
+
+            // don't run (or resume after YIELD) until the condition holds
+            Task *wait (Predicate condition);
+
+            // label used by scheduler tracing; expects a string literal
+            Task *named (const char *n);
+
+            // join a group, along with any dependants not in one already; 
+            // dependants chained later join it too
+            Task *within (TaskGroup *g);
+
+            // when the queue is full, replaces a waiting task with the same 
+            // non-zero key instead of adding to it (see Scheduler::COALESCE)
+            Task *coalesce (size_t k);
+
+            // tasks are recycled through a shared free-list
+            static void *operator new (size_t size);
+            static void operator delete (void *ptr, size_t size);
+        };
+
+        // hierarchical timer wheel; nodes live in a slab and are linked by 
+        // index, so insert and cancel are O(1) and ids can't dangle
+        class TimerWheel
+        {
+            public:
+                typedef uint32_t Id;
+
+                TimerWheel ();
+
+                Id insert (const Task::Callable &work, int priority, int delay, int period);
+                bool cancel (Id id);
+                void advance (frame_delta_t elapsed, Task::Queue &expired);
+                int length ();
+
+            private:
+                struct Timer
+                {
+                    // a fresh slot, linked nowhere
+                    Timer () : 
+                        priority (0), period (0), expires (0), generation (1), 
+                        bucket (-1), prev (-1), next (-1)
+                    {}
+
+                    Task::Callable  work;
+                    int             priority;
+                    int             period;
+                    uint64_t        expires;
+                    uint32_t        generation;
+                    int             bucket;
+                    int             prev;
+                    int             next;
+                };
+
+            private:
+                int allocate_ ();
+                void release_ (int index);
+                void link_ (int index);
+                void unlink_ (int index);
+                void cascade_ (int level);
+
+            private:
+                std::vector <Timer> timers_;
+                int                 buckets_ [TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+                int                 free_;
+                int                 count_;
+                uint64_t            now_;
+                Mutex               lock_;
         };
 
+        // lock-free handoff into a single thread's lane; any thread may post, 
+        // only the owning thread may pop
+        class Mailbox
+        {
+            public:
+                Mailbox ();
+
+                void post (Task *task);
+                Task *pop ();
+                int length ();
+
+            private:
+                QAtomicPointer <Task>   head_;
+                Task                    *cache_;
+                Atomic                  count_;
+        };
+
+        // tasks enqueued from outside go to a shared injection queue, which 
+        // is multi-level by Task::priority; urgent injected work is served 
+        // ahead of a worker's own deque. Dependants of a finished task go to 
+        // the running worker's deque once their last predecessor completes, 
+        // and idle workers steal from the front of other workers' deques.
+        //
+        // tasks pinned to a lane bypass all of that and are posted to the 
+        // mailbox of that worker, or of the main thread, which drains its 
+        // lane once per frame.
+        //
+        // tasks that yield are parked until their condition holds, so a 
+        // worker is never tied up waiting on I/O or a future; delayed and 
+        // periodic work runs off a timer wheel advanced per frame.
+        //
+        // BACKGROUND tasks wait in a queue of their own that a worker 
+        // looks at only when it finds no other work and, in a budgeted 
+        // dispatch, has slack left in the frame. Foreground work preempts 
+        // them at the next task boundary, so long jobs should YIELD often.
+        //
+        // producers feed the injection queue through enqueue, which may be 
+        // bounded. At capacity new tasks block the producer, are rejected, 
+        // or are coalesced by key; saturated() offers a backpressure signal
+        // before that point. Work the scheduler re-injects itself, such as 
+        // resumed tasks, dependants and timers, is always admitted, as is 
+        // anything a running task enqueues under BLOCK, since blocking a 
+        // worker (or a helping thread) could leave none to make room.
+        //
+        // tasks in a cancelled group are dropped, not run, when they are 
+        // next picked up, including parked ones. A dropped task never 
+        // completed, so its dependants fail with it, even those in other 
+        // groups, and every group still drains.
+        //
+        // tracing is opt-in and costs one flag test per task when off.
         class Scheduler
         {
             public:
-                Scheduler ();
+                // outcome of one time-budgeted dispatch pass
+                struct Slice
+                {
+                    int             dispatched;
+                    int             carried;
+                    frame_delta_t   elapsed;
+                };
+
+            public:
+                // behaviour of enqueue once the injection queue is full
+                enum
+                {
+                    BLOCK,
+                    REJECT,
+                    COALESCE
+                };
+
+            public:
+                Scheduler (int workers = 1);
+                ~Scheduler ();
+
+                // takes ownership; false if the task was rejected or coalesced
+                bool enqueue (Task *task);
+                int enqueue (const Task::List &list);
 
-                void enqueue (Task *task);
-                void enqueue (const Task::List &list);
+                // as enqueue, but rejects rather than block when full
+                bool tryEnqueue (Task *task);
                 void dispatch (frame_delta_t delta);
+                bool dispatch (int worker, frame_delta_t delta);
+                Slice dispatch (int worker, frame_delta_t delta, frame_delta_t budget);
+                int drain (int lane, frame_delta_t delta);
+
+                // run one ready task of group on a thread that isn't a worker,
+                // so it can help out while waiting on work it queued; other
+                // work is left alone, since it may expect a worker's thread
+                bool help (TaskGroup *group, frame_delta_t delta);
+
+                // sleep a worker until there is work it could run
+                bool wait (int worker, unsigned long msec = SCHEDULER_IDLE_WAIT);
+                void wake ();
                 int length ();
 
+                // what budgeted passes that ran out left on the workers' deques
+                int carried ();
+                int depth (int priority);
+                int workers () const;
+
+                void setAgingLimit (int dispatches);
+
+                // 0 leaves the injection queue unbounded
+                void setCapacity (int tasks, int policy = BLOCK);
+                bool saturated ();
+                int rejected ();
+
+                // name worker lanes at start-up, then look them up by name
+                void nameLane (int worker, const string &name);
+                int lane (const string &name) const;
+
+                // threads are traced as workers 0..n-1, then the main thread
+                void setTracing (bool enable);
+                TaskTrace *trace ();
+
+                // enqueue a new task for work after delay, then every period
+                TimerWheel::Id schedule (Task::Callable work, int delay, 
+                        int period = 0, int priority = Task::NORMAL);
+                bool cancel (TimerWheel::Id timer);
+                void advance (frame_delta_t elapsed);
+
             private:
+                struct Deque
+                {
+                    typedef std::vector <Deque *> List;
+
+                    Deque () : sleeping (false) {}
+
+                    std::deque <Task *> tasks;
+                    Mutex               lock;
+                    Mailbox             mailbox;
+
+                    // each worker sleeps on its own condition, so a pinned
+                    // post wakes only its target; both under idle_lock_
+                    Condition           wake;
+                    bool                sleeping;
+
+                    // left on the deque when the last budgeted pass ran out
+                    Atomic              carried;
+                };
+
+            private:
+                bool dispatch_ (int worker, frame_delta_t delta, bool background);
+                Task *next_ (int worker);
+                void run_ (int worker, Task *head, frame_delta_t delta);
+                void post_ (Task *task);
+                void ready_stamp_ (Task *task);
+                void drop_ (Task *head);
+                void fail_ (Task *head);
+                void suspend_ (Task *task);
+                int resume_ (int lane, frame_delta_t delta);
+
+                void inject_ (Task *task);
+                void inject_ (Task::Queue &list);
+                bool admit_ (Task *task, bool block);
+                bool coalesce_ (Task *task);
                 void enqueue_ (Task *task);
-                void enqueue_ (const Task::List &list);
-                bool execute_ (Task *head, frame_delta_t delta);
+                void release_ (int worker, const Task::Dependants &list);
+                Task *pop_local_ (int worker);
+                Task *pop_injected_ (int floor);
+                Task *pop_background_ ();
+                void leave_queue_ (Task *head);
+                Task *steal_ (int worker);
+                Task *take_ (TaskGroup *group);
+                void signal_ (int count);
+                void signal_lane_ (int worker);
+                int execute_ (int worker, Task *head, frame_delta_t delta);
                 void dispose_ (Task *head);
 
             private:
-                Task::List  queue_;
+                Task::Queue queue_ [Task::PRIORITIES];
+                int         starved_ [Task::PRIORITIES];
+                Atomic      depth_ [Task::PRIORITIES];
+                int         aging_;
                 Mutex       queue_lock_;
+
+                int         injected_;
+                int         capacity_;
+                int         policy_;
+                int         blocked_;
+                Atomic      rejected_;
+                Atomic      saturated_;
+                Condition   space_;
+                std::map <size_t, Task *> keyed_;
+
+                Task::Queue background_;
+                Atomic      background_depth_;
+
+                Deque::List deques_;
+                Mailbox     main_;
+                Atomic      pending_;
+                Atomic      ready_;
+
+                TimerWheel  timers_;
+
+                Task::Queue parked_;
+                Mutex       parked_lock_;
+                Atomic      suspended_;
+                Atomic      ticks_;
+
+                std::map <string, int> lanes_;
+
+                TaskTrace   *trace_;
+                Atomic      tracing_;
+
+                Mutex       idle_lock_;
+                Atomic      sleepers_;
         };
     }
 }
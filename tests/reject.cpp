@@ -0,0 +1,58 @@
+/* reject.cpp -- a chain refused by a full queue still drains its group
+ *
+ *			Ryan McDougall
+ */
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "delegate.hpp"
+#include "trace.hpp"
+#include "task.hpp"
+
+using namespace Scaffold;
+using namespace Scaffold::Framework;
+
+static Atomic ran;
+
+static int finish (frame_delta_t)
+{
+    ran.ref ();
+    return Task::SUCCESS;
+}
+
+int main ()
+{
+    Scheduler scheduler (1);
+    TaskGroup group;
+
+    scheduler.setCapacity (1, Scheduler::REJECT);
+
+    // fills the queue, so the chain after it is turned away
+    Task *filler = new Task (&finish);
+    filler->within (&group);
+
+    Task *head = new Task (&finish);
+    Task *middle = new Task (&finish);
+    Task *tail = new Task (&finish);
+    head->chain (middle);
+    middle->chain (tail);
+    head->within (&group);
+
+    if (!scheduler.enqueue (filler) || scheduler.enqueue (head))
+    {
+        cerr << "expected the chain to be rejected" << endl;
+        return 1;
+    }
+
+    while (scheduler.dispatch (0, 0));
+
+    // the filler ran, and nothing of the chain did or is still counted
+    if (!group.wait (1000) || ran != 1 || scheduler.rejected () != 1)
+    {
+        cerr << "group left " << group.length () << " after " 
+            << int (ran) << " run" << endl;
+        return 1;
+    }
+
+    return 0;
+}
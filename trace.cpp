@@ -0,0 +1,308 @@
+/* trace.cpp -- opt-in latency histograms, trace capture and frame profiling
+ *
+ *			Ryan McDougall
+ */
+
+#include "stdheaders.hpp"
+#include "clock.hpp"
+#include "trace.hpp"
+
+//=============================================================================
+//
+namespace Scaffold
+{
+    namespace Framework
+    {
+        Histogram::Histogram ()
+        {
+            reset ();
+        }
+
+        void Histogram::record (int64_t value)
+        {
+            value = std::max (value, (int64_t) 0);
+
+            ++ counts_ [bucket_ (value)];
+            ++ count_;
+            sum_ += value;
+            min_ = std::min (min_, value);
+            max_ = std::max (max_, value);
+        }
+
+        void Histogram::reset ()
+        {
+            std::fill (counts_, counts_ + HISTOGRAM_BUCKETS, 0);
+            count_ = sum_ = max_ = 0;
+            min_ = ~0ull >> 1;
+        }
+
+        int64_t Histogram::count () const
+        {
+            return count_;
+        }
+
+        int64_t Histogram::min () const
+        {
+            return count_? min_ : 0;
+        }
+
+        int64_t Histogram::max () const
+        {
+            return max_;
+        }
+
+        double Histogram::mean () const
+        {
+            return count_? (double) sum_ / count_ : 0.0;
+        }
+
+        int64_t Histogram::percentile (double p) const
+        {
+            int64_t rank = (int64_t) ceil (count_ * std::min (std::max (p, 0.0), 100.0) / 100.0);
+            int64_t seen = 0;
+
+            // report the top of the bucket holding the rank, but never past max
+            for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+                if ((seen += counts_ [i]) >= std::max (rank, (int64_t) 1))
+                    return std::min (lower_ (i + 1) - 1, max_);
+
+            return max_;
+        }
+
+        int Histogram::bucket_ (int64_t value)
+        {
+            if (value < (1 << HISTOGRAM_BITS))
+                return value;
+
+            int msb = 0;
+            while (value >> (msb + 1)) ++ msb;
+
+            // keep the top bits as the sub-bucket, the rest as the exponent
+            int exponent = msb - HISTOGRAM_BITS + 1;
+            return exponent * HISTOGRAM_HALF + (value >> exponent);
+        }
+
+        int64_t Histogram::lower_ (int bucket)
+        {
+            if (bucket < (1 << HISTOGRAM_BITS))
+                return bucket;
+
+            int exponent = bucket / HISTOGRAM_HALF - 1;
+            return (int64_t) (bucket - exponent * HISTOGRAM_HALF) << exponent;
+        }
+
+        //---------------------------------------------------------------------
+
+        TaskTrace::TaskTrace (int threads) :
+            busy_ (threads, 0), since_ (Clock::now ()), dropped_ (0)
+        {
+            events_.reserve (TRACE_EVENT_LIMIT);
+        }
+
+        void TaskTrace::record (const char *name, int thread, 
+                usec_t queued, usec_t start, usec_t finish)
+        {
+            if (!name) name = "task";
+
+            Locker mtx (lock_);
+
+            Timing &t = timings_ [name];
+            t.wait.record (start - queued);
+            t.run.record (finish - start);
+
+            busy_ [thread] += finish - start;
+
+            if (events_.size() < TRACE_EVENT_LIMIT)
+            {
+                Event e = { name, thread, start, finish - start };
+                events_.push_back (e);
+            }
+            else
+                ++ dropped_;
+        }
+
+        void TaskTrace::reset ()
+        {
+            Locker mtx (lock_);
+
+            timings_.clear ();
+            events_.clear ();
+            std::fill (busy_.begin(), busy_.end(), 0);
+            since_ = Clock::now ();
+            dropped_ = 0;
+        }
+
+        TaskTrace::Timing TaskTrace::timing (const string &name)
+        {
+            Locker mtx (lock_);
+
+            Timing::Map::iterator i = timings_.find (name);
+            return (i != timings_.end())? i->second : Timing ();
+        }
+
+        double TaskTrace::utilization (int thread)
+        {
+            Locker mtx (lock_);
+
+            usec_t elapsed = Clock::now () - since_;
+            return elapsed? (double) busy_ [thread] / elapsed : 0.0;
+        }
+
+        void TaskTrace::report (std::ostream &out)
+        {
+            Locker mtx (lock_);
+
+            usec_t elapsed = std::max (Clock::now () - since_, (usec_t) 1);
+
+            out << "task timings (usec): name count wait[p50 p99 max] run[p50 p99 max]" << endl;
+
+            Timing::Map::const_iterator i = timings_.begin();
+            Timing::Map::const_iterator e = timings_.end();
+            for (; i != e; ++i)
+            {
+                const Histogram &w = i->second.wait;
+                const Histogram &r = i->second.run;
+
+                out << "  " << i->first << " " << r.count() 
+                    << " wait[" << w.percentile (50) << " " << w.percentile (99) << " " << w.max() << "]"
+                    << " run[" << r.percentile (50) << " " << r.percentile (99) << " " << r.max() << "]" 
+                    << endl;
+            }
+
+            out << "thread utilization:";
+            for (size_t t = 0; t < busy_.size(); ++t)
+                out << " " << t << ":" << std::fixed << std::setprecision (1) 
+                    << (100.0 * busy_ [t] / elapsed) << "%";
+            out << endl;
+
+            if (dropped_)
+                out << "trace events dropped: " << dropped_ << endl;
+        }
+
+        void TaskTrace::write (std::ostream &out)
+        {
+            Locker mtx (lock_);
+
+            out << "{\"traceEvents\":[";
+
+            Event::List::const_iterator i = events_.begin();
+            Event::List::const_iterator e = events_.end();
+            for (; i != e; ++i)
+            {
+                if (i != events_.begin()) out << ",";
+
+                out << "{\"name\":\"";
+                for (const char *c = i->name; *c; ++c)
+                    out << ((*c == '"' || *c == '\\')? "\\" : "") << *c;
+
+                out << "\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":0"
+                    << ",\"tid\":" << i->thread
+                    << ",\"ts\":" << i->start 
+                    << ",\"dur\":" << i->duration << "}";
+            }
+
+            out << "],\"displayTimeUnit\":\"ms\"}" << endl;
+        }
+
+        //=====================================================================
+        //
+        FrameProfiler::FrameProfiler () : 
+            frame_ (0)
+        {}
+
+        void FrameProfiler::record (const char *phase, usec_t elapsed)
+        {
+            Locker mtx (lock_);
+
+            // a phase first seen mid-window took no time in earlier frames
+            std::vector <usec_t> &window = phases_ [phase];
+            if (window.empty())
+                window.resize (PROFILE_WINDOW, 0);
+
+            window [frame_ % PROFILE_WINDOW] += elapsed;
+        }
+
+        void FrameProfiler::nextFrame ()
+        {
+            Locker mtx (lock_);
+
+            ++ frame_;
+
+            // the slot being reused now holds the oldest frame
+            PhaseMap::iterator i = phases_.begin();
+            PhaseMap::iterator e = phases_.end();
+            for (; i != e; ++i)
+                i->second [frame_ % PROFILE_WINDOW] = 0;
+        }
+
+        int FrameProfiler::frames ()
+        {
+            Locker mtx (lock_);
+
+            return std::min (frame_, PROFILE_WINDOW);
+        }
+
+        static usec_t nth_time (std::vector <usec_t> &times, double p)
+        {
+            size_t n = std::min ((size_t) (p / 100.0 * times.size()), times.size() - 1);
+            std::nth_element (times.begin(), times.begin() + n, times.end());
+            return times [n];
+        }
+
+        FrameProfiler::Summary FrameProfiler::summary (const string &phase)
+        {
+            Summary s = { 0, 0, 0, 0, 0 };
+
+            Locker mtx (lock_);
+
+            PhaseMap::iterator i = phases_.find (phase);
+            int count = std::min (frame_, PROFILE_WINDOW);
+
+            if (i == phases_.end() || !count)
+                return s;
+
+            // completed frames only; the current one is still filling in
+            std::vector <usec_t> times;
+            for (int f = 1; f <= count; ++f)
+                times.push_back (i->second [(frame_ - f + PROFILE_WINDOW) % PROFILE_WINDOW]);
+
+            usec_t total = 0;
+            for (size_t n = 0; n < times.size(); ++n)
+                total += times [n];
+
+            s.mean = total / count;
+            s.max = *std::max_element (times.begin(), times.end());
+            s.p50 = nth_time (times, 50);
+            s.p95 = nth_time (times, 95);
+            s.p99 = nth_time (times, 99);
+
+            return s;
+        }
+
+        void FrameProfiler::report (std::ostream &out)
+        {
+            std::vector <string> names;
+            {
+                Locker mtx (lock_);
+
+                PhaseMap::const_iterator i = phases_.begin();
+                PhaseMap::const_iterator e = phases_.end();
+                for (; i != e; ++i) names.push_back (i->first);
+            }
+
+            out << "frame phases (usec over " << frames () 
+                << " frames): name mean p50 p95 p99 max" << endl;
+
+            std::vector <string>::const_iterator i = names.begin();
+            std::vector <string>::const_iterator e = names.end();
+            for (; i != e; ++i)
+            {
+                Summary s = summary (*i);
+                out << "  " << *i << " " << s.mean << " " << s.p50 << " " 
+                    << s.p95 << " " << s.p99 << " " << s.max << endl;
+            }
+        }
+    }
+}
+
+Scaffold::Framework::FrameProfiler *framework_profiler = 0;
@@ -0,0 +1,156 @@
+/* trace.hpp -- opt-in latency histograms, trace capture and frame profiling
+ *
+ *			Ryan McDougall
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+namespace Scaffold
+{
+    namespace Framework
+    {
+        // values below 2^bits are exact; above, each power of two is split
+        // into 2^(bits-1) buckets, so error stays under 2^-(bits-1)
+        const int HISTOGRAM_BITS (5);
+        const int HISTOGRAM_HALF (1 << (HISTOGRAM_BITS - 1));
+        const int HISTOGRAM_BUCKETS ((64 - HISTOGRAM_BITS + 2) * HISTOGRAM_HALF);
+
+        // trace events kept for export; later events are counted and dropped
+        const size_t TRACE_EVENT_LIMIT (1 << 16);
+
+        // frames in the profiler's rolling window
+        const int PROFILE_WINDOW (128);
+
+        // log-linear histogram in the style of HdrHistogram
+        class Histogram
+        {
+            public:
+                Histogram ();
+
+                void record (int64_t value);
+                void reset ();
+
+                int64_t count () const;
+                int64_t min () const;
+                int64_t max () const;
+                double mean () const;
+                int64_t percentile (double p) const;
+
+            private:
+                static int bucket_ (int64_t value);
+                static int64_t lower_ (int bucket);
+
+            private:
+                int64_t counts_ [HISTOGRAM_BUCKETS];
+                int64_t count_;
+                int64_t sum_;
+                int64_t min_;
+                int64_t max_;
+        };
+
+        // wait and run times per task name, busy time per thread, and a 
+        // capped event log that exports as chrome://tracing json
+        class TaskTrace
+        {
+            public:
+                struct Timing
+                {
+                    typedef std::map <string, Timing> Map;
+
+                    Histogram   wait;
+                    Histogram   run;
+                };
+
+                struct Event
+                {
+                    typedef std::vector <Event> List;
+
+                    const char  *name;
+                    int         thread;
+                    usec_t      start;
+                    usec_t      duration;
+                };
+
+            public:
+                TaskTrace (int threads);
+
+                void record (const char *name, int thread, 
+                        usec_t queued, usec_t start, usec_t finish);
+                void reset ();
+
+                Timing timing (const string &name);
+                double utilization (int thread);
+
+                void report (std::ostream &out);
+                void write (std::ostream &out);
+
+            private:
+                Timing::Map             timings_;
+                Event::List             events_;
+                std::vector <usec_t>    busy_;
+                usec_t                  since_;
+                size_t                  dropped_;
+                Mutex                   lock_;
+        };
+
+        // time spent per named phase in each frame, over a rolling window
+        // of recent frames; phases may be entered several times a frame,
+        // and from any thread
+        class FrameProfiler
+        {
+            public:
+                struct Summary
+                {
+                    usec_t  p50;
+                    usec_t  p95;
+                    usec_t  p99;
+                    usec_t  max;
+                    usec_t  mean;
+                };
+
+            public:
+                FrameProfiler ();
+
+                void record (const char *phase, usec_t elapsed);
+                void nextFrame ();
+
+                int frames ();
+                Summary summary (const string &phase);
+
+                void report (std::ostream &out);
+
+            private:
+                typedef std::map <string, std::vector <usec_t> > PhaseMap;
+
+                PhaseMap    phases_;
+                int         frame_;
+                Mutex       lock_;
+        };
+
+        // times the enclosing scope as a phase; does nothing without a profiler
+        class ProfileScope
+        {
+            public:
+                ProfileScope (FrameProfiler *p, const char *phase) : 
+                    profiler_ (p), phase_ (phase), start_ (p? Clock::now () : 0) 
+                {}
+
+                ~ProfileScope () 
+                { 
+                    if (profiler_) 
+                        profiler_->record (phase_, Clock::now () - start_); 
+                }
+
+            private:
+                FrameProfiler   *profiler_;
+                const char      *phase_;
+                usec_t          start_;
+        };
+    }
+}
+
+// set while frame profiling is on, for code with no path to the application
+extern Scaffold::Framework::FrameProfiler *framework_profiler;
+
+#endif //TRACE_H_
@@ -50,6 +50,12 @@ namespace UIPlugin
         notices_.clear ();
     }
 
+    int NotificationProvider::affinity () const
+    {
+        // notices are queued unlocked and shown in the UI
+        return Framework::Task::MAIN_LANE;
+    }
+
     void NotificationProvider::dispatch_notice_ (const View::Notification &note)
     {
         switch (note.type ())
@@ -96,6 +102,12 @@ namespace UIPlugin
     {
     }
 
+    int ActionProvider::affinity () const
+    {
+        // holds no Qt state yet
+        return Framework::Task::ANY_LANE;
+    }
+
     //=========================================================================
 
     KeyBindingProvider::KeyBindingProvider () :
@@ -128,6 +140,12 @@ namespace UIPlugin
     {
     }
 
+    int KeyBindingProvider::affinity () const
+    {
+        // holds no Qt state yet
+        return Framework::Task::ANY_LANE;
+    }
+
     //=========================================================================
 
     SettingsProvider::SettingsProvider () :
@@ -159,6 +177,12 @@ namespace UIPlugin
     void SettingsProvider::update ()
     {
     }
+
+    int SettingsProvider::affinity () const
+    {
+        // holds no Qt state yet
+        return Framework::Task::ANY_LANE;
+    }
     
     //=========================================================================
 
@@ -195,6 +219,12 @@ namespace UIPlugin
     {
     }
 
+    int MainViewProvider::affinity () const
+    {
+        // owns widgets
+        return Framework::Task::MAIN_LANE;
+    }
+
     //=========================================================================
 
     InWorldViewProvider::InWorldViewProvider () :
@@ -229,4 +259,10 @@ namespace UIPlugin
     void InWorldViewProvider::update ()
     {
     }
+
+    int InWorldViewProvider::affinity () const
+    {
+        // owns widgets
+        return Framework::Task::MAIN_LANE;
+    }
 }
@@ -31,6 +31,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
 
         private:
             void dispatch_notice_ (const View::Notification &note);
@@ -53,6 +54,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
     };
 
     //=========================================================================
@@ -69,6 +71,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
     };
 
     //=========================================================================
@@ -85,6 +88,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
     };
 
     //=========================================================================
@@ -101,6 +105,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
 
         private:
             QMainWindow     *main_;
@@ -120,6 +125,7 @@ namespace UIPlugin
             void initialize ();
             void finalize ();
             void update ();
+            int affinity () const;
 
         private:
             QGraphicsView   *view_;
@@ -19,10 +19,35 @@
 namespace ViewerPlugin
 {
     Logic::Logic () : 
-        scheduler (0), session (0), stream (0), app (0), world (0)
+        scheduler (0), session (0), stream (0), logging_in (false), 
+        headless (false), app (0), world (0)
     {
     }
 
+    void Logic::setHeadless (const Connectivity::LoginParameters &params)
+    {
+        headless = true;
+        autologin = params;
+    }
+
+    Connectivity::LoginParameters Logic::readLoginConfig (const QString &path)
+    {
+        Connectivity::LoginParameters params;
+        QSettings config (path, QSettings::IniFormat);
+
+        QStringList names = config.value ("avatar/names").toString().split (" ");
+        if (names.count() == 2)
+        {
+            params.insert ("first", names.at(0));
+            params.insert ("last", names.at(1));
+        }
+
+        params.insert ("pass", config.value ("avatar/password").toString());
+        params.insert ("service", config.value ("world/host").toString());
+
+        return params;
+    }
+
     void Logic::initialize (Framework::Scheduler *s)
     {
         scheduler = s;
@@ -31,32 +56,58 @@ namespace ViewerPlugin
 
         // add our custom providers to the service managers
         service_session_manager->attach (new LLPlugin::SessionProvider);
-        service_notification_manager->attach (new UIPlugin::NotificationProvider);
-        service_action_manager->attach (new UIPlugin::ActionProvider);
-        service_keybinding_manager->attach (new UIPlugin::KeyBindingProvider);
-        service_settings_manager->attach (new UIPlugin::SettingsProvider);
-        service_view_manager->attach (new UIPlugin::MainViewProvider);
-        service_view_manager->attach (new UIPlugin::InWorldViewProvider);
+
+        if (!headless)
+        {
+            service_notification_manager->attach (new UIPlugin::NotificationProvider);
+            service_action_manager->attach (new UIPlugin::ActionProvider);
+            service_keybinding_manager->attach (new UIPlugin::KeyBindingProvider);
+            service_settings_manager->attach (new UIPlugin::SettingsProvider);
+            service_view_manager->attach (new UIPlugin::MainViewProvider);
+            service_view_manager->attach (new UIPlugin::InWorldViewProvider);
+        }
 
         // get the application entity
-        Model::Entity *app_entity = model_entities->get ("application");
+        Model::Entity *app_entity = model_entities->get (APPLICATION_ENTITY);
 
-        if (app_entity->has ("application-state-component"))
+        if (app_entity->has (APPLICATION_STATE_COMPONENT))
         {
-            app = app_entity->get <Framework::AppState> ("application-state-component");
-            app->state.on_value_change += bind (&Logic::on_app_state_change, this, _1);
+            app = app_entity->get <Framework::AppState> (APPLICATION_STATE_COMPONENT);
+            app_state_link = app->state.on_value_change += 
+                bind (&Logic::on_app_state_change, this, _1);
+            backpressure_link = app->backpressure.on_value_change += 
+                bind (&Logic::on_backpressure_change, this, _1);
         }
 
-        if (app_entity->has ("application-worldstate-component"))
+        if (app_entity->has (APPLICATION_WORLDSTATE_COMPONENT))
         {
-            world = app_entity->get <Framework::WorldState> ("application-worldstate-component");
-            world->state.on_value_change += bind (&Logic::on_world_state_change, this, _1);
+            world = app_entity->get <Framework::WorldState> (APPLICATION_WORLDSTATE_COMPONENT);
+            world_state_link = world->state.on_value_change += 
+                bind (&Logic::on_world_state_change, this, _1);
         }
     }
 
     void Logic::finalize ()
     {
         cout << "module finalize" << endl;
+
+        login_tasks.cancel ();
+
+        // the application entity outlives us, so stop listening to it
+        if (app)
+        {
+            app->state.on_value_change.disconnect (app_state_link);
+            app->backpressure.on_value_change.disconnect (backpressure_link);
+        }
+
+        if (world)
+            world->state.on_value_change.disconnect (world_state_link);
+    }
+
+    int Logic::affinity () const
+    {
+        // attaches main lane providers, which start as they are attached
+        return Framework::Task::MAIN_LANE;
     }
 
     void Logic::on_app_state_change (int state)
@@ -73,6 +124,12 @@ namespace ViewerPlugin
         }
     }
 
+    void Logic::on_backpressure_change (bool saturated)
+    {
+        if (stream)
+            stream->setThrottled (saturated);
+    }
+
     void Logic::on_world_state_change (int state)
     {
         cout << "world state changed: " << state << endl;
@@ -89,6 +146,13 @@ namespace ViewerPlugin
                 {
                     cout << "logging in" << endl;
 
+                    if (headless)
+                    {
+                        mark_login_ready ();
+                        on_login (autologin);
+                        break;
+                    }
+
                     // set up the main view with our login UI
                     QMainWindow *main = static_cast <QMainWindow *> 
                         (service_view_manager->retire ("main-view"));
@@ -102,6 +166,8 @@ namespace ViewerPlugin
                     main->setGeometry (100, 100, 400, 200);
                     main->setCentralWidget (widget);
                     main->show();
+
+                    mark_login_ready ();
                 }
                 break;
 
@@ -115,6 +181,7 @@ namespace ViewerPlugin
                 {
                     cout << "logging out" << endl;
                     
+                    login_tasks.cancel ();
                     do_logout ();
                 }
                 break;
@@ -124,6 +191,7 @@ namespace ViewerPlugin
                 {
                     cout << "exiting" << endl;
 
+                    login_tasks.cancel ();
                     do_exit ();
                 }
                 break;
@@ -132,11 +200,46 @@ namespace ViewerPlugin
 
     void Logic::on_login (Connectivity::LoginParameters params)
     {
-        Framework::Task *task;
+        Framework::Task *task, *start, *read;
 
-        task = new Framework::Task (bind (&Logic::do_login, this, params));
-        task->chain (new Framework::Task (bind (&Logic::do_start_world_stream, this)));
-        task->chain (new Framework::Task (bind (&Logic::do_read_world_stream, this)));
+        // a new login supersedes any chain still in flight. Its steps run 
+        // on this thread, so none is mid-run, and one pass over the main 
+        // lane drops whatever is still queued or parked
+        login_tasks.cancel ();
+        scheduler->drain (Framework::Task::MAIN_LANE, 0);
+
+        if (login_tasks.length ())
+        {
+            cout << "previous login still running, try again" << endl;
+            return;
+        }
+
+        login_tasks.reset ();
+
+        // a dropped login may have left its first pass's state behind
+        logging_in = false;
+        login = QFuture <Connectivity::Session *> ();
+
+        // each step drives the stream, which like the message factory it 
+        // shares with every other stream is main thread only; so chain them
+        // strictly in order, all on the main lane
+        read = new Framework::Task (bind (&Logic::do_read_world_stream, this),
+                Framework::Task::NORMAL, Framework::Task::MAIN_LANE);
+        read->named ("read-world-stream");
+        read->wait (bind (&Logic::is_world_stream_ready, this));
+
+        start = new Framework::Task (bind (&Logic::do_start_world_stream, this),
+                Framework::Task::NORMAL, Framework::Task::MAIN_LANE);
+        start->named ("start-world-stream");
+        start->chain (read);
+
+        // login suspends while the session is established, freeing the lane
+        task = new Framework::Task (bind (&Logic::do_login, this, params),
+                Framework::Task::NORMAL, Framework::Task::MAIN_LANE);
+        task->named ("login");
+        task->wait (bind (&Logic::is_login_ready, this));
+        task->chain (start);
+        task->within (&login_tasks);
 
         scheduler->enqueue (task);
     }
@@ -147,11 +250,20 @@ namespace ViewerPlugin
         world->state = Framework::WorldState::EXIT;
     }
     
-    bool Logic::do_login (Connectivity::LoginParameters parms)
+    int Logic::do_login (Connectivity::LoginParameters parms)
     {
         bool success = false;
 
-        QFuture <Connectivity::Session *> login = service_session_manager->retire (parms);
+        // first pass starts the login, then we yield until it completes
+        if (!logging_in)
+        {
+            login = service_session_manager->retire (parms);
+            logging_in = true;
+
+            return Framework::Task::YIELD;
+        }
+
+        logging_in = false;
 
         if (!login.isCanceled()) 
         {
@@ -187,12 +299,30 @@ namespace ViewerPlugin
 
     bool Logic::do_read_world_stream ()
     {
-        if (stream->waitForRead ())
-            world->state = Framework::WorldState::IN;
+        world->state = Framework::WorldState::IN;
 
         return true;
     }
 
+    bool Logic::is_login_ready ()
+    {
+        return !logging_in || login.isFinished ();
+    }
+
+    bool Logic::is_world_stream_ready ()
+    {
+        // the socket is drained on the main thread, so pending datagrams
+        // say nothing here; what has been read is safe to ask from anywhere
+        return stream->received () > 0;
+    }
+
+    void Logic::mark_login_ready ()
+    {
+        // only the first login belongs to start-up
+        if (!app->login_ready.get ())
+            app->login_ready = Clock::now () - app->started.get ();
+    }
+
     bool Logic::do_logout ()
     {
         if (stream && stream->isConnected())
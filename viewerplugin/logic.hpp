@@ -36,14 +36,23 @@ namespace ViewerPlugin
         public:
             Logic ();
 
+            // log straight in with params, with no UI providers or widgets
+            void setHeadless (const Connectivity::LoginParameters &params);
+
+            // login parameters from an ini file laid out as the login UI 
+            // saves them: avatar/names, avatar/password, world/host
+            static Connectivity::LoginParameters readLoginConfig (const QString &path);
+
             // module functions
             void initialize (Framework::Scheduler *s);
             void finalize ();
+            int affinity () const;
 
         public:
             // updated from the application entity
             void on_app_state_change (int state);
             void on_world_state_change (int state);
+            void on_backpressure_change (bool saturated);
 
         public slots:
             // updated from the login UI
@@ -52,19 +61,37 @@ namespace ViewerPlugin
 
         protected:
             // logic functions
-            bool do_login (Connectivity::LoginParameters);
+            int do_login (Connectivity::LoginParameters);
             bool do_start_world_stream ();
             bool do_read_world_stream ();
             bool do_logout ();
             bool do_exit ();
 
+            // resume conditions for suspended logic functions
+            bool is_login_ready ();
+            bool is_world_stream_ready ();
+
+            // records how long start-up took to reach the login
+            void mark_login_ready ();
+
         private:
             Framework::Scheduler    *scheduler;
             LLPlugin::Session       *session;
             LLPlugin::Stream        *stream;
 
+            QFuture <Connectivity::Session *> login;
+            bool                    logging_in;
+            Framework::TaskGroup    login_tasks;
+
+            bool                    headless;
+            Connectivity::LoginParameters autologin;
+
             Framework::AppState     *app;
             Framework::WorldState   *world;
+
+            Connection              app_state_link;
+            Connection              backpressure_link;
+            Connection              world_state_link;
     };
 }
 